@@ -15,10 +15,15 @@
 
 
 #include "LEDRingSmall.h"
-#include <Wire.h>
+#include "i2cbus.h"
 
 LEDRingSmall::LEDRingSmall(uint8_t add) {
   _add = add;
+  // Measured by the chip, never cached
+  _shadow.setVolatile(ISSI3746_PAGE1, ISSI3746_OPENSHORT);
+  _shadow.setVolatile(ISSI3746_PAGE1, ISSI3746_TEMPERATURE);
+  // Write-only trigger, must always go out
+  _shadow.setVolatile(ISSI3746_PAGE1, ISSI3746_RESET_REG);
 }
 
 void LEDRingSmall::LEDRingSmall_PWM_MODE(void) {
@@ -67,6 +72,8 @@ void LEDRingSmall::LEDRingSmall_SpreadSpectrum(uint8_t spread) {
 void LEDRingSmall::LEDRingSmall_Reset(void) {
   selectBank(ISSI3746_PAGE1);
   writeRegister8(ISSI3746_RESET_REG, 0xAE);
+  // All registers are back at their defaults, page included
+  _shadow.invalidate();
 }
 
 void LEDRingSmall::LEDRingSmall_PWMFrequencyEnable(uint8_t PWMenable) {
@@ -103,6 +110,20 @@ void  LEDRingSmall::LEDRingSmall_Set_BLUE(uint8_t led_n, uint8_t color) {
   writeRegister8(issi_led_map[2][led_n], color);
 }
 
+// Consecutive PWM registers in one auto-increment transfer (page 0 must be selected)
+void  LEDRingSmall::LEDRingSmall_Set_PWM_Burst(uint8_t reg, uint8_t *data, uint8_t dim) {
+  writeBuff(reg, data, dim);
+}
+
+void  LEDRingSmall::LEDRingSmall_InvalidateShadow(void) {
+  _shadow.invalidate();
+}
+
+// PWM register of one color (0 = red, 1 = green, 2 = blue) of an LED
+uint8_t LEDRingSmall::LEDRingSmall_PWM_Register(uint8_t color, uint8_t led_n) const {
+  return issi_led_map[color][led_n];
+}
+
 void  LEDRingSmall::LEDRingSmall_ClearAll(void) {
   LEDRingSmall_PWM_MODE();
   
@@ -114,33 +135,40 @@ void  LEDRingSmall::LEDRingSmall_ClearAll(void) {
   
 
 void  LEDRingSmall::selectBank(uint8_t b) {
-  writeRegister8(ISSI3746_COMMANDREGISTER_LOCK, ISSI3746_ULOCK_CODE);
-  writeRegister8(ISSI3746_COMMANDREGISTER, b);
+  if (!_shadow.selectPage(b)) {
+    return;
+  }
+  // Unlock and page registers are the same on every page
+  i2cBus.writeAsync(_add, ISSI3746_COMMANDREGISTER_LOCK, ISSI3746_ULOCK_CODE, I2CPriority::Background);
+  i2cBus.writeAsync(_add, ISSI3746_COMMANDREGISTER, b, I2CPriority::Background);
 }
 
 void LEDRingSmall::writeRegister8(uint8_t reg, uint8_t data) {
-  Wire.beginTransmission(_add);
-  Wire.write(reg);
-  Wire.write(data);
-  Wire.endTransmission();
+  if (!_shadow.write(_shadow.currentPage(), reg, data)) {
+    return;
+  }
+  // Queued on the shared bus; order per device is preserved
+  i2cBus.writeAsync(_add, reg, data, I2CPriority::Background);
 }
 
 void LEDRingSmall::writeBuff(uint8_t reg, uint8_t *data, uint8_t dim) {
-  Wire.beginTransmission(_add);
-  Wire.write(reg);
-  Wire.write(data, dim);
-  Wire.endTransmission();
+  _shadow.storeBurst(_shadow.currentPage(), reg, data, dim);
+  // Split so a long update never holds off haptic writes for long
+  const uint8_t chunk = I2CBus::MAX_PAYLOAD - 1;
+  for (uint8_t offset = 0; offset < dim; offset += chunk) {
+    uint8_t len = (dim - offset) < chunk ? (dim - offset) : chunk;
+    i2cBus.writeAsync(_add, reg + offset, data + offset, len, I2CPriority::Background);
+  }
 }
 
 uint8_t LEDRingSmall::readRegister8(uint8_t reg) {
-   byte rdata = 0xFF;
-
-  Wire.beginTransmission(_add);
-  Wire.write(reg);
-  Wire.endTransmission();
-  Wire.requestFrom(_add, (uint8_t) 1);
-  if (Wire.available()) {
-    rdata = Wire.read();
+  uint8_t rdata = 0xFF;
+
+  if (_shadow.read(_shadow.currentPage(), reg, rdata)) {
+    return rdata;
+  }
+  if (i2cBus.read(_add, reg, &rdata, 1, I2CPriority::Background) == 0) {
+    _shadow.store(_shadow.currentPage(), reg, rdata);
   }
   return rdata;
 }
@@ -22,6 +22,8 @@
 #include <WProgram.h>
 #endif
 
+#include "registershadow.h"
+
 #define ISSI3746_PAGE0 0x00
 #define ISSI3746_PAGE1 0x01
 
@@ -73,6 +75,12 @@ class LEDRingSmall {
     void LEDRingSmall_Set_GREEN(uint8_t led_n, uint8_t color);
     void LEDRingSmall_Set_BLUE(uint8_t led_n, uint8_t color);
     void LEDRingSmall_ClearAll(void);
+    void LEDRingSmall_Set_PWM_Burst(uint8_t reg, uint8_t *data, uint8_t dim);
+    uint8_t LEDRingSmall_PWM_Register(uint8_t color, uint8_t led_n) const;
+
+    // Register cache: redundant page selects and writes are not sent
+    void LEDRingSmall_InvalidateShadow(void);
+    const RegisterShadow<2>& LEDRingSmall_Shadow(void) const { return _shadow; }
 
   private:
     const uint8_t issi_led_map[3][24] = {
@@ -82,6 +90,7 @@ class LEDRingSmall {
     };
 
     uint8_t _add;
+    RegisterShadow<2> _shadow;
     void  selectBank(uint8_t b);
     void  writeRegister8(uint8_t reg, uint8_t data);
     void  writeBuff(uint8_t reg, uint8_t *data, uint8_t dim);
@@ -0,0 +1,158 @@
+#pragma once
+#include <Arduino.h>
+#include <Control_Surface.h>
+#include <chrono>
+
+/**
+ * @brief Packs outgoing Bluetooth MIDI into one notification per connection interval
+ *
+ * Control Surface builds BLE-MIDI packets itself: each message goes into
+ * the current packet with its own 13-bit millisecond timestamp, taken as
+ * the message is added, and the packet is sent when it is full, when
+ * sendNow() is called or after the interface timeout. The packer sits on
+ * the transmit route and decides when to flush:
+ *
+ *   Control_Surface >> blePacker >> midibt;
+ *   blePacker.sendControlChange({25, Channel_1}, value);   // direct sends
+ *
+ * Messages are forwarded to the packet builder immediately, so their
+ * timestamps are the time they were produced, and update() (from the loop)
+ * flushes once the oldest unsent message is a connection interval old.
+ * Everything produced within one interval then shares one notification
+ * instead of taking a connection event each. The interface timeout is set
+ * to two intervals as a backstop for a stalled loop.
+ *
+ * Stats count the packets the packer flushes; a packet that fills the MTU
+ * first is sent by Control Surface on its own and merges into the next
+ * count. Queueing delay is from a message entering the packer to its flush.
+ * Loop task only.
+ */
+class BLEMIDIPacker : public MIDI_Pipe {
+public:
+    static constexpr uint16_t DEFAULT_INTERVAL_MS = 15;  // Common central default (iOS, macOS)
+    static constexpr uint16_t MIN_INTERVAL_MS = 8;       // 7.5 ms is the BLE minimum
+    static constexpr uint16_t MAX_INTERVAL_MS = 100;
+
+    struct Stats {
+        uint32_t messages;
+        uint32_t packets;
+        uint32_t packedMessages;     // Messages in those packets
+        uint32_t maxMessagesPerPacket;
+        uint32_t dropped;            // Produced while disconnected
+        uint64_t totalDelayUs;       // Summed over flushed messages
+        uint32_t maxDelayUs;
+    };
+
+    explicit BLEMIDIPacker(BluetoothMIDI_Interface& ble) : ble(ble) {}
+
+    void begin(uint16_t intervalMs = DEFAULT_INTERVAL_MS) {
+        setInterval(intervalMs);
+        resetStats();
+    }
+
+    /**
+     * @brief Set the connection interval to pack to (clamped to 8..100 ms)
+     */
+    void setInterval(uint16_t intervalMs) {
+        intervalMs = constrain(intervalMs, MIN_INTERVAL_MS, MAX_INTERVAL_MS);
+        intervalUs = (uint32_t)intervalMs * 1000;
+        ble.setTimeout(std::chrono::milliseconds(2 * intervalMs));
+    }
+
+    uint16_t getInterval() const { return intervalUs / 1000; }
+
+    /**
+     * @brief Send a control change through the packer (like midibt.sendControlChange())
+     */
+    void sendControlChange(MIDIAddress address, uint8_t value) {
+        mapForwardMIDI(ChannelMessage(MIDIMessageType::ControlChange, address.getChannel(),
+                                      address.getAddress(), value));
+    }
+
+    /**
+     * @brief Flush the packet once its oldest message is an interval old
+     */
+    void update() {
+        if (pending == 0) {
+            return;
+        }
+        uint32_t nowUs = micros();
+        if (!ble.isConnected()) {
+            stats.dropped += pending;
+            pending = 0;
+            return;
+        }
+        if (nowUs - firstPendingUs >= intervalUs) {
+            flush(nowUs);
+        }
+    }
+
+    Stats getStats() const { return stats; }
+
+    void resetStats() {
+        stats = {};
+        statsStartMs = millis();
+    }
+
+    void printStats(Stream& out) const {
+        uint32_t elapsedMs = millis() - statsStartMs;
+        out.print("BLE MIDI out: interval ");
+        out.print(getInterval());
+        out.print(" ms, ");
+        out.print(stats.messages);
+        out.print(" messages in ");
+        out.print(stats.packets);
+        out.print(" packets (");
+        out.print(elapsedMs ? stats.packets * 1000.0f / elapsedMs : 0.0f, 1);
+        out.println(" packets/s)");
+        out.print("  Messages per packet avg: ");
+        out.print(stats.packets ? (float)stats.packedMessages / stats.packets : 0.0f, 2);
+        out.print(", max: ");
+        out.print(stats.maxMessagesPerPacket);
+        out.print("; dropped while disconnected: ");
+        out.println(stats.dropped);
+        out.print("  Queueing delay avg: ");
+        out.print(stats.packedMessages ? (uint32_t)(stats.totalDelayUs / stats.packedMessages) : 0);
+        out.print(" us, max: ");
+        out.print(stats.maxDelayUs);
+        out.println(" us");
+    }
+
+protected:
+    using MIDI_Pipe::mapForwardMIDI;
+
+    void mapForwardMIDI(ChannelMessage msg) override {
+        uint32_t nowUs = micros();
+        if (pending == 0) {
+            firstPendingUs = nowUs;
+            pendingStampSumUs = 0;
+        }
+        // Delays are summed relative to the first message, so no per-message storage
+        pendingStampSumUs += nowUs - firstPendingUs;
+        pending++;
+        stats.messages++;
+        sourceMIDItoSink(msg);
+    }
+
+private:
+    BluetoothMIDI_Interface& ble;
+    uint32_t intervalUs = DEFAULT_INTERVAL_MS * 1000;
+
+    uint32_t pending = 0;
+    uint32_t firstPendingUs = 0;
+    uint64_t pendingStampSumUs = 0;
+
+    Stats stats = {};
+    uint32_t statsStartMs = 0;
+
+    void flush(uint32_t nowUs) {
+        ble.sendNow();
+        uint32_t maxDelayUs = nowUs - firstPendingUs;
+        stats.packets++;
+        stats.packedMessages += pending;
+        stats.totalDelayUs += (uint64_t)pending * maxDelayUs - pendingStampSumUs;
+        if (pending > stats.maxMessagesPerPacket) stats.maxMessagesPerPacket = pending;
+        if (maxDelayUs > stats.maxDelayUs) stats.maxDelayUs = maxDelayUs;
+        pending = 0;
+    }
+};
@@ -3,20 +3,51 @@
 #include <Control_Surface.h>
 
 class CLI {
+public:
+  // Handler for bit-specific commands; args is the text after the command name
+  typedef void (*CommandHandler)(Stream& out, const String& args);
+
 private:
+  static const uint8_t MAX_COMMANDS = 16;
+
+  struct Command {
+    const char* name;
+    const char* help;
+    CommandHandler handler;
+  };
+
   Stream& serial;
   BluetoothMIDI_Interface& midiInterface;
   unsigned long lastStatusPrint;
   const unsigned long statusInterval;
+  Command commands[MAX_COMMANDS];
+  uint8_t commandCount;
 
 public:
   CLI(Stream& serialRef, BluetoothMIDI_Interface& midiRef, unsigned long interval = 10000) 
-    : serial(serialRef), midiInterface(midiRef), lastStatusPrint(0), statusInterval(interval) {}
+    : serial(serialRef), midiInterface(midiRef), lastStatusPrint(0), statusInterval(interval),
+      commandCount(0) {}
 
   void begin() {
     lastStatusPrint = 0;
   }
 
+  /**
+   * @brief Register a bit-specific command
+   * 
+   * @param name Command word typed on the serial console
+   * @param help One-line description shown by 'help'
+   * @param handler Called with the rest of the line as arguments
+   * @return false if the command table is full
+   */
+  bool addCommand(const char* name, const char* help, CommandHandler handler) {
+    if (commandCount >= MAX_COMMANDS) {
+      return false;
+    }
+    commands[commandCount++] = {name, help, handler};
+    return true;
+  }
+
   void update() {
     handlePeriodicStatus();
     handleSerialCommands();
@@ -37,6 +68,10 @@ private:
       String command = serial.readStringUntil('\n');
       command.trim();
       
+      if (dispatchCommand(command)) {
+        return;
+      }
+      
       if (command == "status") {
         printStatus();
       }
@@ -54,6 +89,21 @@ private:
     }
   }
 
+  bool dispatchCommand(const String& line) {
+    int split = line.indexOf(' ');
+    String name = split < 0 ? line : line.substring(0, split);
+    String args = split < 0 ? String("") : line.substring(split + 1);
+    args.trim();
+    
+    for (uint8_t i = 0; i < commandCount; i++) {
+      if (name == commands[i].name) {
+        commands[i].handler(serial, args);
+        return true;
+      }
+    }
+    return false;
+  }
+
   void printStatus() {
     serial.println("MIDI Bridge Status:");
     serial.print("  Uptime: ");
@@ -77,6 +127,12 @@ private:
     serial.println("  status - Show bridge status");
     serial.println("  help   - Show this help");
     serial.println("  test   - Send test MIDI message");
+    for (uint8_t i = 0; i < commandCount; i++) {
+      serial.print("  ");
+      serial.print(commands[i].name);
+      serial.print(" - ");
+      serial.println(commands[i].help);
+    }
   }
 
   void sendTestNote() {
@@ -0,0 +1,672 @@
+#pragma once
+#include <stdint.h>
+#include <math.h>
+
+/**
+ * @brief PI controller with clamped output and anti-windup
+ *
+ * Output = kp * error + integral, limited to [outMin, outMax]. The
+ * integral is clamped to the same range and only integrates until the
+ * output reaches the limit in the direction of the error (conditional
+ * integration), so a long saturation does not wind up and the loop
+ * recovers without overshoot when the error changes sign.
+ *
+ * Plain C++ without Arduino dependencies, so it can be tested on the host
+ * against the plant models below.
+ */
+class PIController {
+public:
+    PIController(float kp, float ki, float outMin = 0.0f, float outMax = 1.0f)
+        : kp(kp), ki(ki), outMin(outMin), outMax(outMax) {}
+
+    void setGains(float newKp, float newKi) {
+        kp = newKp;
+        ki = newKi;
+    }
+
+    float getKp() const { return kp; }
+    float getKi() const { return ki; }
+
+    /**
+     * @brief Restart from a known output (bumpless when taking over)
+     */
+    void reset(float output = 0.0f) {
+        integral = clamp(output);
+        output_ = integral;
+        saturated = false;
+    }
+
+    /**
+     * @param dtS Time since the last update, seconds
+     * @return The new output
+     */
+    float update(float setpoint, float measured, float dtS) {
+        float error = setpoint - measured;
+        float proportional = kp * error;
+
+        float candidate = integral + ki * error * dtS;
+        // Integrate only up to the point where the output saturates
+        if (error > 0 && proportional + candidate > outMax) {
+            candidate = fmaxf(integral, outMax - proportional);
+        } else if (error < 0 && proportional + candidate < outMin) {
+            candidate = fminf(integral, outMin - proportional);
+        }
+        integral = clamp(candidate);
+
+        float output = proportional + integral;
+        saturated = output > outMax || output < outMin;
+        output_ = clamp(output);
+        return output_;
+    }
+
+    float getOutput() const { return output_; }
+    float getIntegral() const { return integral; }
+    bool isSaturated() const { return saturated; }
+
+private:
+    float kp;
+    float ki;
+    float outMin;
+    float outMax;
+    float integral = 0.0f;
+    float output_ = 0.0f;
+    bool saturated = false;
+
+    float clamp(float v) const {
+        return v < outMin ? outMin : (v > outMax ? outMax : v);
+    }
+};
+
+/**
+ * @brief PID controller with a rate-limited output and a clamped integrator
+ *
+ * For plants that need to be driven both ways (inflate and deflate): the
+ * output is signed. On top of what PIController does:
+ * - the derivative acts on the measurement, not the error, so setpoint
+ *   steps do not kick the output, and is low-pass filtered
+ * - the integrator has its own clamp, below the output range, so it can
+ *   hold a steady load (a leak) but never drive the plant by itself
+ * - the output may change by at most outputRatePerS per second, so the
+ *   actuators never reverse or jump in one sample
+ */
+class PIDController {
+public:
+    PIDController(float kp, float ki, float kd, float outMin = -1.0f, float outMax = 1.0f)
+        : kp(kp), ki(ki), kd(kd), outMin(outMin), outMax(outMax),
+          integralMin(outMin), integralMax(outMax) {}
+
+    void setGains(float newKp, float newKi, float newKd) {
+        kp = newKp;
+        ki = newKi;
+        kd = newKd;
+    }
+
+    float getKp() const { return kp; }
+    float getKi() const { return ki; }
+    float getKd() const { return kd; }
+
+    /**
+     * @brief Limit the integral term to [-limit, limit] (within the output range)
+     */
+    void setIntegralLimit(float limit) {
+        integralMin = fmaxf(-limit, outMin);
+        integralMax = fminf(limit, outMax);
+        integral = fminf(fmaxf(integral, integralMin), integralMax);
+    }
+
+    /**
+     * @param perS Largest output change per second, 0 = unlimited
+     */
+    void setOutputRateLimit(float perS) { outputRatePerS = perS; }
+
+    /**
+     * @param tauS Time constant of the derivative filter
+     */
+    void setDerivativeFilter(float tauS) { derivativeTauS = tauS; }
+
+    void reset(float output = 0.0f) {
+        output_ = clamp(output);
+        integral = fminf(fmaxf(output_, integralMin), integralMax);
+        derivative = 0;
+        hasLast = false;
+        saturated = false;
+    }
+
+    /**
+     * @param dtS Time since the last update, seconds
+     * @return The new output
+     */
+    float update(float setpoint, float measured, float dtS) {
+        float error = setpoint - measured;
+        float proportional = kp * error;
+
+        if (hasLast && dtS > 0) {
+            float raw = -(measured - lastMeasured) / dtS;
+            float alpha = dtS / (derivativeTauS + dtS);
+            derivative += alpha * (raw - derivative);
+        }
+        lastMeasured = measured;
+        hasLast = true;
+        float derivativeTerm = kd * derivative;
+
+        float candidate = integral + ki * error * dtS;
+        // Integrate only up to the point where the output saturates
+        float others = proportional + derivativeTerm;
+        if (error > 0 && others + candidate > outMax) {
+            candidate = fmaxf(integral, outMax - others);
+        } else if (error < 0 && others + candidate < outMin) {
+            candidate = fminf(integral, outMin - others);
+        }
+        integral = fminf(fmaxf(candidate, integralMin), integralMax);
+
+        float output = others + integral;
+        saturated = output > outMax || output < outMin;
+        output = clamp(output);
+        if (outputRatePerS > 0 && dtS > 0) {
+            float maxStep = outputRatePerS * dtS;
+            output = fminf(fmaxf(output, output_ - maxStep), output_ + maxStep);
+        }
+        output_ = output;
+        return output_;
+    }
+
+    float getOutput() const { return output_; }
+    float getIntegral() const { return integral; }
+    bool isSaturated() const { return saturated; }
+
+private:
+    float kp;
+    float ki;
+    float kd;
+    float outMin;
+    float outMax;
+    float integralMin;
+    float integralMax;
+    float outputRatePerS = 0.0f;
+    float derivativeTauS = 0.05f;
+    float integral = 0.0f;
+    float derivative = 0.0f;     // Filtered -d(measured)/dt
+    float lastMeasured = 0.0f;
+    bool hasLast = false;
+    float output_ = 0.0f;
+    bool saturated = false;
+
+    float clamp(float v) const {
+        return v < outMin ? outMin : (v > outMax ? outMax : v);
+    }
+};
+
+/**
+ * @brief First-order low-pass filter
+ */
+class LowPassFilter {
+public:
+    explicit LowPassFilter(float tauS) : tauS(tauS) {}
+
+    float update(float value, float dtS) {
+        if (!primed) {
+            state = value;
+            primed = true;
+        } else {
+            state += dtS / (tauS + dtS) * (value - state);
+        }
+        return state;
+    }
+
+    float get() const { return state; }
+
+    void reset() { primed = false; }
+
+private:
+    float tauS;
+    float state = 0.0f;
+    bool primed = false;
+};
+
+/**
+ * @brief Step response metrics of a regulated value
+ *
+ * Call begin() when the setpoint steps, then add() every measurement.
+ * Rise time is 10% to 90% of the step, settling time the last time the
+ * value was outside the band around the target, overshoot is relative to
+ * the step size, steady-state error the mean error over the last quarter
+ * of the samples (up to the ring below).
+ */
+class StepMetrics {
+public:
+    static constexpr float SETTLE_BAND = 0.05f;  // Of the step size
+    static constexpr uint8_t TAIL_SAMPLES = 32;
+
+    struct Result {
+        float from;
+        float target;
+        float riseTimeS;       // < 0 if the 90% point was not reached
+        float settlingTimeS;   // < 0 if never settled
+        float overshootPct;
+        float steadyStateError;
+        uint32_t samples;
+    };
+
+    void begin(float timeS, float from, float target) {
+        startS = timeS;
+        result = {};
+        result.from = from;
+        result.target = target;
+        result.riseTimeS = -1.0f;
+        result.settlingTimeS = -1.0f;
+        t10 = -1.0f;
+        lastOutsideS = timeS;
+        peak = from;
+        tailCount = 0;
+        active = true;
+    }
+
+    void add(float timeS, float value) {
+        if (!active) return;
+        float step = result.target - result.from;
+        float progress = step != 0.0f ? (value - result.from) / step : 1.0f;
+
+        if (t10 < 0 && progress >= 0.1f) t10 = timeS;
+        if (result.riseTimeS < 0 && progress >= 0.9f && t10 >= 0) result.riseTimeS = timeS - t10;
+
+        if ((step >= 0 && value > peak) || (step < 0 && value < peak)) peak = value;
+        float overshoot = step != 0.0f ? (peak - result.target) / step * 100.0f : 0.0f;
+        result.overshootPct = overshoot > 0 ? overshoot : 0;
+
+        float band = fabsf(step) * SETTLE_BAND;
+        if (fabsf(value - result.target) > band) {
+            lastOutsideS = timeS;
+            result.settlingTimeS = -1.0f;
+        } else {
+            result.settlingTimeS = lastOutsideS - startS;
+        }
+
+        tail[tailCount % TAIL_SAMPLES] = result.target - value;
+        tailCount++;
+        result.samples++;
+    }
+
+    /**
+     * @brief Metrics so far
+     */
+    Result get() const {
+        Result r = result;
+        uint32_t n = tailCount / 4;
+        if (n > TAIL_SAMPLES) n = TAIL_SAMPLES;
+        if (n == 0) n = tailCount < TAIL_SAMPLES ? tailCount : TAIL_SAMPLES;
+        float sum = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            sum += tail[(tailCount - 1 - i) % TAIL_SAMPLES];
+        }
+        r.steadyStateError = n ? sum / n : 0;
+        return r;
+    }
+
+    bool isActive() const { return active; }
+
+private:
+    Result result = {};
+    float startS = 0;
+    float t10 = -1.0f;
+    float lastOutsideS = 0;
+    float peak = 0;
+    float tail[TAIL_SAMPLES] = {};
+    uint32_t tailCount = 0;
+    bool active = false;
+};
+
+/**
+ * @brief First-order thermal model of a load, driven by measured power
+ *
+ *   C * dRise/dt = P - G * rise
+ *
+ * rise is the temperature above ambient, C the heat capacity (J/C) and G
+ * the loss to ambient (W/C); the time constant is C / G. Without a
+ * temperature sensor this is the best guess of how warm the load is: it
+ * integrates the power that was really delivered, so cooling while off or
+ * at a lower setting is accounted for.
+ */
+class ThermalEstimator {
+public:
+    ThermalEstimator(float heatCapacityJPerC, float lossWPerC)
+        : heatCapacity(heatCapacityJPerC), loss(lossWPerC) {}
+
+    void setModel(float heatCapacityJPerC, float lossWPerC) {
+        heatCapacity = heatCapacityJPerC;
+        loss = lossWPerC;
+    }
+
+    float getHeatCapacity() const { return heatCapacity; }
+    float getLoss() const { return loss; }
+    float getTimeConstantS() const { return heatCapacity / loss; }
+
+    void update(float powerW, float dtS) {
+        // Exact step for constant power over dt, stable for any dt
+        float steady = steadyStateRise(powerW);
+        rise = steady + (rise - steady) * expf(-dtS / getTimeConstantS());
+    }
+
+    float getRise() const { return rise; }
+
+    /**
+     * @brief Rise the load settles at with a constant power
+     */
+    float steadyStateRise(float powerW) const {
+        return powerW / loss;
+    }
+
+    void reset(float riseC = 0) {
+        rise = riseC;
+    }
+
+private:
+    float heatCapacity;
+    float loss;
+    float rise = 0;
+};
+
+/**
+ * @brief Pressure hold with the valves closed and learned top-up pulses
+ *
+ * Between pulses the pillow only leaks, so the decay is measured: a line
+ * fitted to each closed-valve segment gives the leak in hPa/s, and
+ * divided by the mean pressure the leak constant (per second), which
+ * scales to any hold pressure. Each pulse is measured too: the rise it
+ * produced after the pressure settled, plus what leaked meanwhile, per
+ * second of pulse is the pump gain.
+ *
+ * A pulse starts when the pressure, projected over the sensor lag, is
+ * about to leave the band at the bottom, and is sized to reach the upper
+ * half of the band. Pulsing from the bottom edge to near the top makes
+ * the intervals as long as the band allows, so the pump runs as rarely
+ * (and, at a fixed moderate PWM, as quietly) as the leak permits.
+ *
+ * update() runs on every sample and returns the length of a pulse to
+ * start now; the caller runs the pump for exactly that long.
+ */
+class LeakHold {
+public:
+    static constexpr float SETTLE_S = 0.3f;          // After a pulse, before measuring
+    static constexpr float MIN_PULSE_S = 0.05f;
+    static constexpr float MAX_PULSE_S = 2.0f;
+    static constexpr float INITIAL_GAIN_HPA_PER_S = 10.0f;  // Until the first pulse is measured
+    static constexpr float LEARN_RATE = 0.3f;        // Weight of each new measurement
+    static constexpr uint32_t MIN_FIT_SAMPLES = 20;
+
+    /**
+     * @param bandHPa Hold within target +- band
+     * @param lagS Sensor filter and burst delay
+     */
+    explicit LeakHold(float bandHPa = 2.0f, float lagS = 0.05f) : bandHPa(bandHPa), lagS(lagS) {}
+
+    void setBand(float hPa) { bandHPa = hPa; }
+    float getBand() const { return bandHPa; }
+
+    /**
+     * @brief Start holding at target; learned values are kept
+     */
+    void begin(float timeS, float targetHPa) {
+        target = targetHPa;
+        startS = timeS;
+        pulseEndS = timeS;
+        pulseS = 0;
+        pumpOnS = 0;
+        pulses = 0;
+        lost = false;
+        beginSegment(timeS);
+    }
+
+    /**
+     * @param pressureHPa Filtered pressure, same reference as the target
+     * @return Seconds to run the pump from now, 0 for none
+     */
+    float update(float timeS, float pressureHPa) {
+        if (timeS < pulseEndS + SETTLE_S) {
+            return 0;  // Pulsing or settling
+        }
+        if (pulseS > 0) {
+            learnGain(pressureHPa);
+            pulseS = 0;
+            beginSegment(timeS);
+        }
+        if (pressureHPa > target + 2 * bandHPa || pressureHPa < target - 3 * bandHPa) {
+            // Loaded or a leak the pulses cannot keep up with: the caller regulates again
+            lost = true;
+            return 0;
+        }
+        addSample(timeS, pressureHPa);
+
+        float projected = pressureHPa - getLeakHPaPerS(pressureHPa) * lagS;
+        if (projected > target - bandHPa) {
+            return 0;
+        }
+
+        finishSegment();
+        float rise = target + bandHPa * 0.5f - pressureHPa;
+        float duration = rise / gainHPaPerS;
+        duration = duration < MIN_PULSE_S ? MIN_PULSE_S : (duration > MAX_PULSE_S ? MAX_PULSE_S : duration);
+        pulseS = duration;
+        pulseStartS = timeS;
+        pulseStartHPa = pressureHPa;
+        pulseEndS = timeS + duration;
+        pumpOnS += duration;
+        pulses++;
+        return duration;
+    }
+
+    /**
+     * @brief The pressure left the hold range; regulate again
+     */
+    bool isLost() const { return lost; }
+
+    /**
+     * @brief Learned leak at a pressure, hPa/s (positive = falling)
+     */
+    float getLeakHPaPerS(float pressureHPa) const { return leakPerS * pressureHPa; }
+
+    /**
+     * @brief Learned leak constant, per second (0 until measured)
+     */
+    float getLeakPerS() const { return leakPerS; }
+
+    /**
+     * @brief Learned pressure rise per second of pulse
+     */
+    float getPumpGainHPaPerS() const { return gainHPaPerS; }
+
+    /**
+     * @brief Share of the time the pump ran since begin()
+     */
+    float getDutyCycle(float timeS) const {
+        float elapsed = timeS - startS;
+        return elapsed > 0 ? pumpOnS / elapsed : 0;
+    }
+
+    uint32_t getPulses() const { return pulses; }
+
+private:
+    float bandHPa;
+    float lagS;
+    float target = 0;
+    float startS = 0;
+    float pulseStartS = 0;
+    float pulseStartHPa = 0;
+    float pulseEndS = 0;
+    float pulseS = 0;             // Length of the pulse being settled, 0 if none
+    float pumpOnS = 0;
+    uint32_t pulses = 0;
+    bool lost = false;
+
+    float leakPerS = 0;
+    bool leakKnown = false;
+    float gainHPaPerS = 0;
+    bool gainKnown = false;
+
+    // Line fit of the current decay segment, time relative to its start
+    float segmentStartS = 0;
+    uint32_t n = 0;
+    float sumT = 0, sumP = 0, sumTT = 0, sumTP = 0;
+
+    void beginSegment(float timeS) {
+        segmentStartS = timeS;
+        n = 0;
+        sumT = sumP = sumTT = sumTP = 0;
+        if (!gainKnown) gainHPaPerS = INITIAL_GAIN_HPA_PER_S;
+    }
+
+    void addSample(float timeS, float pressureHPa) {
+        float t = timeS - segmentStartS;
+        n++;
+        sumT += t;
+        sumP += pressureHPa;
+        sumTT += t * t;
+        sumTP += t * pressureHPa;
+    }
+
+    void finishSegment() {
+        float spanS = n > 1 ? (sumTT - sumT * sumT / n) : 0;
+        if (n < MIN_FIT_SAMPLES || spanS <= 0) {
+            return;  // Too short to tell the slope from noise
+        }
+        float slope = (sumTP - sumT * sumP / n) / spanS;
+        float meanP = sumP / n;
+        if (meanP <= 0) {
+            return;
+        }
+        float measured = -slope / meanP;
+        if (measured < 0) measured = 0;
+        leakPerS = leakKnown ? leakPerS + LEARN_RATE * (measured - leakPerS) : measured;
+        leakKnown = true;
+    }
+
+    void learnGain(float pressureHPa) {
+        float leaked = getLeakHPaPerS(pressureHPa) * (pulseEndS + SETTLE_S - pulseStartS);
+        float measured = (pressureHPa - pulseStartHPa + leaked) / pulseS;
+        if (measured <= 0) {
+            return;
+        }
+        gainHPaPerS = gainKnown ? gainHPaPerS + LEARN_RATE * (measured - gainHPaPerS) : measured;
+        gainKnown = true;
+    }
+};
+
+/**
+ * @brief Heat pad plant as seen through the INA219, for tuning without hardware
+ *
+ * Pad resistance rises with temperature, the supply sags with current, and
+ * the measurement is the mean power over the previous conversion (the PWM
+ * is locked to the ADC, so there is no ripple). Defaults are fitted to
+ * tools/heat/heat.txt: ~9 V supply, ~10.8 W at full duty.
+ */
+struct HeatPlantModel {
+    float supplyV = 9.1f;
+    float sourceOhm = 0.25f;
+    float padOhm25C = 7.2f;
+    float tempcoPerC = 0.0035f;     // Resistance change per degree
+    float heatCapacityJPerC = 15.0f;
+    float lossWPerC = 0.12f;        // To ambient
+    float ambientC = 25.0f;
+    float noiseW = 0.03f;           // Measurement noise amplitude
+
+    float temperatureC = 25.0f;
+
+    /**
+     * @brief Advance by dtS at a PWM duty of 0..1
+     *
+     * @return Power measured over the interval, watts
+     */
+    float step(float duty, float dtS) {
+        float padOhm = padOhm25C * (1.0f + tempcoPerC * (temperatureC - ambientC));
+        float current = supplyV / (padOhm + sourceOhm);
+        float power = duty * current * current * padOhm;
+        temperatureC += (power - lossWPerC * (temperatureC - ambientC)) * dtS / heatCapacityJPerC;
+        return power + noiseW * noise();
+    }
+
+private:
+    uint32_t seed = 12345;
+
+    float noise() {
+        seed = seed * 1664525u + 1013904223u;
+        return ((int32_t)(seed >> 8) - (1 << 23)) / (float)(1 << 23);
+    }
+};
+
+/**
+ * @brief Pillow, pumps and valves of the air bit as seen through the LPS28
+ *
+ * Pressure is gauge (hPa above ambient). The command is signed like the
+ * PIDController output: above holdBand the inflate pump runs into the
+ * pillow through the inflate valve, with a flow that drops to zero at the
+ * pump's stall pressure; below -holdBand the deflate pump and valve empty
+ * it, helped by the pillow's own pressure through the open valve; in
+ * between both valves are closed and only the leak remains. The
+ * magnitude is the share of the pump's working range (the device maps it
+ * above the PWM the pumps start at). The measurement lags by the sensor
+ * burst and carries noise.
+ */
+struct AirPlantModel {
+    float inflateHPaPerS = 40.0f;   // Full inflate pump into an empty pillow
+    float stallHPa = 350.0f;        // Inflate pump dead-heads here
+    float deflateHPaPerS = 40.0f;   // Full deflate pump
+    float ventPerS = 0.3f;          // Outflow per hPa through the open deflate valve
+    float leakPerS = 0.005f;        // Outflow per hPa with the valves closed
+    float holdBand = 0.02f;
+    float lagS = 0.04f;             // One FIFO burst at 100 Hz / watermark 4
+    float noiseHPa = 0.05f;
+
+    float pressureHPa = 0.0f;
+
+    /**
+     * @brief Advance by dtS with a command of -1..1
+     *
+     * @return Pressure measured at the end of the interval, hPa gauge
+     */
+    float step(float command, float dtS) {
+        float rate;
+        if (command > holdBand) {
+            rate = inflateHPaPerS * command * (1.0f - pressureHPa / stallHPa);
+        } else if (command < -holdBand) {
+            rate = deflateHPaPerS * command - ventPerS * pressureHPa;
+        } else {
+            rate = -leakPerS * pressureHPa;
+        }
+        pressureHPa += rate * dtS;
+        if (pressureHPa < 0) pressureHPa = 0;
+
+        measured += dtS / (lagS + dtS) * (pressureHPa - measured);
+        return measured + noiseHPa * noise();
+    }
+
+private:
+    float measured = 0.0f;
+    uint32_t seed = 12345;
+
+    float noise() {
+        seed = seed * 1664525u + 1013904223u;
+        return ((int32_t)(seed >> 8) - (1 << 23)) / (float)(1 << 23);
+    }
+};
+
+/**
+ * @brief Run a control loop against a plant model from rest to a target
+ *
+ * The controller output is applied one sample late, like on the device
+ * where it is written after the snapshot that produced it.
+ *
+ * @return Step metrics of the simulated response
+ */
+template <class Controller, class Plant>
+StepMetrics::Result simulateStep(Controller& controller, Plant plant, float target,
+                                 float dtS, float durationS) {
+    StepMetrics metrics;
+    controller.reset(0);
+    metrics.begin(0, 0, target);
+    float duty = 0;
+    for (float t = dtS; t <= durationS; t += dtS) {
+        float measured = plant.step(duty, dtS);
+        metrics.add(t, measured);
+        duty = controller.update(target, measured, dtS);
+    }
+    return metrics.get();
+}
@@ -1,19 +1,7 @@
 #pragma once
 #include <Arduino.h>
 #include <Control_Surface.h>
-#include <memory>
-
-// Forward declarations
-struct HapticStep;
-using HapticEffect = std::vector<HapticStep>;
-
-// External effect declarations
-extern const HapticEffect EFFECT_CONST_VIBE;
-extern const HapticEffect EFFECT_PULSE_PURR;
-extern const HapticEffect EFFECT_AUDIO_NOISE;
-extern const HapticEffect EFFECT_WAVE;
-extern const HapticEffect EFFECT_BRADYCARDIA_HEAVY;
-extern const HapticEffect EFFECT_STRONG_BUZZ;
+#include "hapticeffects.h"
 
 class EffectEncoder {
 public:
@@ -39,16 +27,11 @@ public:
         return -1; // No change
     }
     
-    std::shared_ptr<HapticEffect> getEffect(int effectIndex) {
-        switch(effectIndex) {
-            case 0: return std::make_shared<HapticEffect>(EFFECT_CONST_VIBE);
-            case 1: return std::make_shared<HapticEffect>(EFFECT_PULSE_PURR);
-            case 2: return std::make_shared<HapticEffect>(EFFECT_AUDIO_NOISE);
-            case 3: return std::make_shared<HapticEffect>(EFFECT_WAVE);
-            case 4: return std::make_shared<HapticEffect>(EFFECT_BRADYCARDIA_HEAVY);
-            case 5: return std::make_shared<HapticEffect>(EFFECT_STRONG_BUZZ);
-            default: return std::make_shared<HapticEffect>(EFFECT_CONST_VIBE);
+    const HapticEffect* getEffect(int effectIndex) {
+        if (effectIndex < 0 || effectIndex >= EFFECT_LIBRARY_SIZE) {
+            return EFFECT_LIBRARY[0];
         }
+        return EFFECT_LIBRARY[effectIndex];
     }
 
 private:
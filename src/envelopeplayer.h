@@ -0,0 +1,231 @@
+#pragma once
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+#include "hapticcodec.h"
+#include "steptiming.h"
+
+/**
+ * @brief Plays stored envelopes on any actuator with deadline timing
+ *
+ * HapticPlayer's timing engine (DeadlineClock) without the DRV2605 and
+ * the mixer: envelopes are HapticEffect tables (raw steps, encoded or
+ * synth, walked with HapticDecoder), each step's amplitude goes to an
+ * output callback, and every step has an absolute deadline, so steps are
+ * exact to tens of microseconds whatever the loop, BLE or Serial are
+ * doing. Nothing runs between steps, so a slow heat or breathing envelope
+ * costs a wake-up per step, not per tick.
+ *
+ * play() hands over to the task without waiting (like
+ * HapticPlayer::setEffect()): envelopes are immutable and live in flash.
+ * The new envelope starts immediately, cutting the current one. stop()
+ * and release() wait (microseconds) until the task has taken the request,
+ * so no envelope output can land after they return.
+ *
+ * The output callback runs on the player task; what the amplitude means
+ * (a duty, a signed pump command) is up to it. When an envelope ends or
+ * is stopped the callback gets the rest amplitude; release() skips it for
+ * callers that write the actuator themselves right after.
+ */
+class EnvelopePlayer {
+public:
+    // Above the loop task and the BLE host, below the esp_timer task that wakes us
+    static constexpr UBaseType_t TASK_PRIORITY = 18;
+    // stop()/release() give up waiting for the task after this
+    static constexpr int64_t ACK_TIMEOUT_US = 5000;
+
+    typedef void (*Output)(uint8_t amplitude, void* arg);
+
+    EnvelopePlayer(Output output, void* arg, uint8_t restAmplitude = 0)
+        : output(output), outputArg(arg), restAmplitude(restAmplitude) {}
+
+    /**
+     * @brief Start the player task (idle until play())
+     */
+    bool begin(BaseType_t core = 0) {
+        if (task != nullptr) {
+            return true;
+        }
+        if (!clock.begin("envelope_step")) {
+            return false;
+        }
+        xTaskCreatePinnedToCore(taskLoop, "EnvelopePlayer", 3072, this, TASK_PRIORITY, &task, core);
+        return task != nullptr;
+    }
+
+    /**
+     * @param envelope Envelope with static lifetime, nullptr stops
+     * @param loop Start over at the end until stopped
+     */
+    void play(const HapticEffect* envelope, bool loop = false) {
+        request(envelope, loop, true);
+    }
+
+    /**
+     * @brief Stop and write the rest amplitude (if an envelope was playing)
+     */
+    void stop() {
+        waitForTask(request(nullptr, false, true));
+    }
+
+    /**
+     * @brief Stop without the rest output: the caller takes the actuator over
+     */
+    void release() {
+        waitForTask(request(nullptr, false, false));
+    }
+
+    /**
+     * @brief An envelope owns the actuator (from play() until it ends or is stopped)
+     */
+    bool isPlaying() const {
+        return requested.load(std::memory_order_relaxed) != nullptr &&
+               finishedGeneration.load(std::memory_order_acquire) != requestGeneration.load(std::memory_order_relaxed);
+    }
+
+    const HapticEffect* getEnvelope() const { return current; }
+
+    StepTimingStats getTimingStats() const {
+        return clock.getStats();
+    }
+
+    void resetTimingStats() {
+        clock.resetStats();
+    }
+
+    void printTimingStats(Stream& out) const {
+        StepTimingStats stats = getTimingStats();
+        out.print("  Steps: ");
+        out.print(stats.steps);
+        out.print(", resyncs: ");
+        out.print(stats.resyncs);
+        out.print(", envelopes played: ");
+        out.println(envelopesPlayed);
+        stats.printLateness(out);
+        stats.printCost(out, "Output");
+        stats.printHistogram(out);
+    }
+
+private:
+    Output output;
+    void* outputArg;
+    uint8_t restAmplitude;
+    TaskHandle_t task = nullptr;
+    DeadlineClock clock;
+
+    // Requests: fields first, then the generation is bumped to publish them
+    std::atomic<const HapticEffect*> requested{nullptr};
+    volatile bool requestedLoop = false;
+    volatile bool requestedRest = true;
+    std::atomic<uint32_t> requestGeneration{0};
+    std::atomic<uint32_t> takenGeneration{0};     // Last request the task acted on
+    std::atomic<uint32_t> finishedGeneration{0};  // Request whose envelope ran to its end
+    volatile uint32_t envelopesPlayed = 0;
+
+    // Player task only
+    const HapticEffect* volatile current = nullptr;
+    bool looping = false;
+    HapticDecoder decoder;
+
+    uint32_t request(const HapticEffect* envelope, bool loop, bool rest) {
+        requestedLoop = loop;
+        requestedRest = rest;
+        requested.store(envelope, std::memory_order_relaxed);
+        uint32_t generation = requestGeneration.fetch_add(1, std::memory_order_release) + 1;
+        if (task != nullptr) {
+            xTaskNotifyGive(task);
+        }
+        return generation;
+    }
+
+    /**
+     * @brief Wait until the task has acted on a request (any task but the player)
+     *
+     * The player runs at a high priority, so this is normally a few
+     * microseconds; the timeout only covers a task starved by an ISR storm.
+     */
+    void waitForTask(uint32_t generation) {
+        if (task == nullptr || xTaskGetCurrentTaskHandle() == task) {
+            return;
+        }
+        int64_t deadlineUs = esp_timer_get_time() + ACK_TIMEOUT_US;
+        while ((int32_t)(takenGeneration.load(std::memory_order_acquire) - generation) < 0 &&
+               esp_timer_get_time() < deadlineUs) {
+        }
+    }
+
+    /**
+     * @brief Block until the next step is due or a request arrives
+     *
+     * @return true if the step is due
+     */
+    bool waitForStep() {
+        if (current == nullptr) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            return false;
+        }
+        return clock.sleep();
+    }
+
+    /**
+     * @brief Switch to a requested envelope, if any
+     *
+     * @return true if one was taken (it starts now)
+     */
+    bool takeRequest() {
+        uint32_t generation = requestGeneration.load(std::memory_order_acquire);
+        if (generation == takenGeneration.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        const HapticEffect* previous = current;
+        current = requested.load(std::memory_order_relaxed);
+        looping = requestedLoop;
+        if (current == nullptr) {
+            if (previous != nullptr && requestedRest) {
+                output(restAmplitude, outputArg);  // Stopped mid-envelope
+            }
+        } else {
+            decoder.reset(current);
+            clock.restart();
+            envelopesPlayed++;
+        }
+        // Acknowledged only now: nothing from the old envelope can follow
+        takenGeneration.store(generation, std::memory_order_release);
+        return current != nullptr;
+    }
+
+    static void taskLoop(void* param) {
+        auto self = static_cast<EnvelopePlayer*>(param);
+        while (true) {
+            bool due = self->waitForStep();
+            if (self->takeRequest()) {
+                due = true;  // A new envelope starts now
+            }
+            if (self->current == nullptr || !due) {
+                continue;  // Idle, or an early wake-up without a new envelope
+            }
+            int64_t nowUs = esp_timer_get_time();
+
+            HapticStep step;
+            if (!self->decoder.next(step)) {
+                if (self->looping) {
+                    self->decoder.rewind();
+                }
+                if (!self->looping || !self->decoder.next(step)) {
+                    self->output(self->restAmplitude, self->outputArg);
+                    self->current = nullptr;
+                    // A play() since then has a newer generation and keeps isPlaying()
+                    self->finishedGeneration.store(self->takenGeneration.load(std::memory_order_relaxed),
+                                                   std::memory_order_release);
+                    continue;
+                }
+            }
+            self->output(step.amplitude, self->outputArg);
+            int32_t costUs = (int32_t)(esp_timer_get_time() - nowUs);
+            self->clock.updateStats([&](StepTimingStats& stats) { stats.recordCost(costUs); });
+            self->clock.advance(nowUs, (uint32_t)step.delayMs * 1000);
+        }
+    }
+};
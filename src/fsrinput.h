@@ -0,0 +1,258 @@
+#pragma once
+#include <Arduino.h>
+#include <Control_Surface.h>
+#include <driver/adc.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+#include "touchchannel.h"
+#include "trace.h"
+
+/**
+ * @brief Filter and emission settings of FSRInput
+ *
+ * Values are on the 14-bit scale used by the mapping function.
+ */
+struct FSRFilterConfig {
+    volatile uint8_t emaShift = 2;      // EMA over blocks, weight 1/2^n; 0 = block mean only
+    uint16_t hysteresis = 48;           // Beyond a CC step boundary before the CC changes
+    uint16_t minIntervalMs = 10;        // At most one CC per interval (100/s)
+};
+
+/**
+ * @brief FSR input sampled by the continuous ADC (DMA)
+ *
+ * Replacement for CCPotentiometer. The ADC runs at SAMPLE_RATE_HZ into DMA
+ * buffers; a task averages each block of BLOCK_SAMPLES (1.6 ms), runs a
+ * short EMA over the block means and publishes the result. update() runs
+ * from Control_Surface.loop() and sends one CC when the value leaves the
+ * hysteresis band around the last CC sent, no faster than minIntervalMs.
+ * A change that is rate limited is sent once the interval has passed, so
+ * the final value is never lost.
+ *
+ * Every block is also published, mapped, on touchChannel() for consumers
+ * that want the reading without MIDI in between (haptic touch-through).
+ *
+ * Only pins on ADC1 are supported (A0 is GPIO1, ADC1 channel 0).
+ */
+class FSRInput : public Updatable<> {
+public:
+    static constexpr uint32_t SAMPLE_RATE_HZ = 20000;
+    static constexpr uint16_t BLOCK_SAMPLES = 32;
+    static constexpr analog_t MAX_VALUE = 16383;  // 14-bit scale
+
+    typedef analog_t (*MappingFunction)(analog_t raw);
+
+    FSRInput(uint8_t pin, MIDIAddress midiAddress) : pin(pin), address(midiAddress) {}
+
+    /**
+     * @brief Map the filtered 14-bit reading before it becomes a CC
+     */
+    void map(MappingFunction fn) {
+        mapping.store(fn, std::memory_order_relaxed);
+    }
+
+    void begin() override {
+        int8_t ch = digitalPinToAnalogChannel(pin);
+        if (ch < 0 || ch >= 10) {
+            Serial.println(F("FSR: pin is not on ADC1"));
+            return;
+        }
+        channel = ch;
+
+        adc_digi_init_config_t init = {};
+        init.max_store_buf_size = BLOCK_BYTES * 4;
+        init.conv_num_each_intr = BLOCK_BYTES;
+        init.adc1_chan_mask = BIT(channel);
+        init.adc2_chan_mask = 0;
+
+        adc_digi_pattern_config_t pattern = {};
+        pattern.atten = ADC_ATTEN_DB_11;
+        pattern.channel = channel;
+        pattern.unit = 0;  // ADC1
+        pattern.bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+
+        adc_digi_configuration_t config = {};
+        config.conv_limit_en = false;
+        config.conv_limit_num = 250;
+        config.pattern_num = 1;
+        config.adc_pattern = &pattern;
+        config.sample_freq_hz = SAMPLE_RATE_HZ;
+        config.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+        config.format = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+
+        if (adc_digi_initialize(&init) != ESP_OK ||
+            adc_digi_controller_configure(&config) != ESP_OK ||
+            adc_digi_start() != ESP_OK) {
+            Serial.println(F("FSR: could not start continuous ADC"));
+            return;
+        }
+
+        // Same core as the Arduino loop, above it so blocks are never missed
+        xTaskCreatePinnedToCore(acquisitionTask, "FSR_ADC", 3072, this, 5, &taskHandle, 1);
+    }
+
+    void update() override {
+        analog_t value = getValue();
+
+        if (sentAny) {
+            int32_t lower = (int32_t)lastCC * 128 - filter.hysteresis;
+            int32_t upper = (int32_t)lastCC * 128 + 127 + filter.hysteresis;
+            if (value >= lower && value <= upper) {
+                waitingForRate = false;  // Went back, nothing to send
+                return;
+            }
+        }
+
+        uint32_t now = millis();
+        if (sentAny && now - lastSentMs < filter.minIntervalMs) {
+            if (!waitingForRate) {
+                rateLimited++;
+                waitingForRate = true;
+            }
+            return;
+        }
+
+        lastCC = value >> 7;
+        tracer.begin(TracePath::FsrMidi);
+        Control_Surface.sendControlChange(address, lastCC);
+        lastSentMs = now;
+        sentAny = true;
+        waitingForRate = false;
+        ccSent++;
+    }
+
+    FSRFilterConfig& config() { return filter; }
+
+    const TouchChannel& touchChannel() const { return touch; }
+
+    /**
+     * @brief Latest filtered reading, 14-bit, before mapping
+     */
+    analog_t getRawValue() const {
+        return filtered.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Latest filtered reading after mapping, 14-bit
+     */
+    analog_t getValue() const {
+        analog_t raw = getRawValue();
+        MappingFunction fn = mapping.load(std::memory_order_relaxed);
+        analog_t value = fn ? fn(raw) : raw;
+        return value > MAX_VALUE ? MAX_VALUE : value;
+    }
+
+    void printStats(Stream& out) const {
+        out.print("FSR (continuous ADC, ");
+        out.print(SAMPLE_RATE_HZ);
+        out.print(" Hz, ");
+        out.print(BLOCK_SAMPLES);
+        out.println(" samples per block)");
+        out.print("  Blocks: ");
+        out.print(blocks);
+        out.print(", samples: ");
+        out.print(samples);
+        out.print(", read errors: ");
+        out.println(readErrors);
+        out.print("  Raw: ");
+        out.print(getRawValue());
+        out.print(", mapped: ");
+        out.print(getValue());
+        out.print(", last CC: ");
+        out.println(lastCC);
+        out.print("  CCs sent: ");
+        out.print(ccSent);
+        out.print(", rate limited: ");
+        out.println(rateLimited);
+        out.print("  Filter: EMA shift ");
+        out.print(filter.emaShift);
+        out.print(", hysteresis ");
+        out.print(filter.hysteresis);
+        out.print(", min interval ");
+        out.print(filter.minIntervalMs);
+        out.println(" ms");
+    }
+
+private:
+    static constexpr uint32_t BLOCK_BYTES = BLOCK_SAMPLES * SOC_ADC_DIGI_RESULT_BYTES;
+
+    uint8_t pin;
+    uint8_t channel = 0;
+    MIDIAddress address;
+    std::atomic<MappingFunction> mapping{nullptr};  // Also used by the acquisition task
+    FSRFilterConfig filter;
+    TaskHandle_t taskHandle = nullptr;
+    TouchChannel touch;
+
+    // Written by the acquisition task
+    std::atomic<analog_t> filtered{0};
+    volatile uint32_t blocks = 0;
+    volatile uint32_t samples = 0;
+    volatile uint32_t readErrors = 0;
+
+    // Loop task only
+    uint8_t lastCC = 0;
+    bool sentAny = false;
+    bool waitingForRate = false;
+    uint32_t lastSentMs = 0;
+    uint32_t ccSent = 0;
+    uint32_t rateLimited = 0;
+
+    static void acquisitionTask(void* param) {
+        auto self = static_cast<FSRInput*>(param);
+        uint8_t buffer[BLOCK_BYTES];
+        uint32_t emaAccumulator = 0;
+        uint8_t emaShift = 0;
+        bool first = true;
+        analog_t lastPublished = MAX_VALUE + 1;
+
+        while (true) {
+            uint32_t length = 0;
+            esp_err_t err = adc_digi_read_bytes(buffer, sizeof(buffer), &length, ADC_MAX_DELAY);
+            if (err != ESP_OK) {
+                // Also returned when the driver buffer overflowed and data was lost
+                self->readErrors++;
+                if (err != ESP_ERR_INVALID_STATE) continue;
+            }
+
+            uint32_t sum = 0;
+            uint32_t count = 0;
+            for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= length; i += SOC_ADC_DIGI_RESULT_BYTES) {
+                auto sample = reinterpret_cast<adc_digi_output_data_t*>(&buffer[i]);
+                if (sample->type2.unit == 0 && sample->type2.channel == self->channel) {
+                    sum += sample->type2.data;
+                    count++;
+                }
+            }
+            if (count == 0) continue;
+
+            // 12-bit block mean on the 14-bit scale
+            uint32_t mean = (sum << 2) / count;
+            uint8_t shift = self->filter.emaShift;
+            if (first) {
+                emaAccumulator = mean << shift;
+                first = false;
+            } else if (shift != emaShift) {
+                // Filter changed from the CLI: rescale, keep the current output
+                emaAccumulator = (emaAccumulator >> emaShift) << shift;
+            }
+            emaShift = shift;
+            emaAccumulator += mean - (emaAccumulator >> shift);
+            uint32_t value = emaAccumulator >> shift;
+
+            if (value > MAX_VALUE) value = MAX_VALUE;
+            self->filtered.store(value, std::memory_order_relaxed);
+            analog_t mapped = self->getValue();
+            if (mapped != lastPublished) {
+                // Only changes move the actuator; one traced at a time
+                tracer.beginIfIdle(TracePath::FsrTouch);
+                lastPublished = mapped;
+            }
+            self->touch.publish(mapped, (uint32_t)esp_timer_get_time());
+            self->blocks++;
+            self->samples += count;
+        }
+    }
+};
@@ -0,0 +1,213 @@
+#pragma once
+#include "hapticstep.h"
+#include "hapticsynth.h"
+
+/**
+ * @brief Compact encoded effect format
+ *
+ * Sample-based effects repeat the same delay for every step and change
+ * amplitude in small increments, so they are stored as a byte stream on a
+ * shared time base (one tick = HapticEffect::timebaseMs, the GCD of all step
+ * delays, or its largest divisor that fits in a byte). Every token sets the amplitude and holds it for some ticks:
+ *
+ *   00dddddd            DELTA   amplitude += d (signed 6-bit), hold 1 tick
+ *   01nnnnnn            REPEAT  keep amplitude, hold n+1 ticks (1-64)
+ *   10nnnnnn aaaaaaaa   SET     amplitude = a, hold n+1 ticks (1-64)
+ *   11xxxxxx            reserved
+ *
+ * The amplitude starts at 0. The stream is produced at compile time from a
+ * normal step table, so effects stay readable in source:
+ *
+ *   constexpr auto FOO_CODED = encodeEffect<encodedSize(FOO_STEPS)>(FOO_STEPS);
+ *   constexpr HapticEffect EFFECT_FOO = makeEffect(FOO_CODED);
+ *
+ * Only the encoded bytes are emitted; the source table is never odr-used.
+ */
+namespace HapticCodec {
+    constexpr uint8_t OP_MASK   = 0xC0;
+    constexpr uint8_t OP_DELTA  = 0x00;
+    constexpr uint8_t OP_REPEAT = 0x40;
+    constexpr uint8_t OP_SET    = 0x80;
+    constexpr uint8_t ARG_MASK  = 0x3F;
+    constexpr uint8_t MAX_RUN   = 64;
+    constexpr int DELTA_MIN     = -32;
+    constexpr int DELTA_MAX     = 31;
+
+    constexpr uint16_t gcd(uint16_t a, uint16_t b) {
+        while (b != 0) {
+            uint16_t t = a % b;
+            a = b;
+            b = t;
+        }
+        return a;
+    }
+
+    constexpr uint8_t timebase(const HapticStep* steps, size_t count) {
+        uint16_t g = 0;
+        for (size_t i = 0; i < count; i++) {
+            g = gcd(g, steps[i].delayMs);
+        }
+        if (g == 0) {
+            return 1;  // No delays at all
+        }
+        // Long steps only (e.g. 1000 ms): any divisor of the GCD is exact too
+        for (uint16_t t = g < 255 ? g : 255; t > 1; t--) {
+            if (g % t == 0) {
+                return static_cast<uint8_t>(t);
+            }
+        }
+        return 1;
+    }
+
+    // Encode into out (or only count bytes when out is nullptr)
+    constexpr size_t encode(const HapticStep* steps, size_t count, uint8_t tick, uint8_t* out) {
+        size_t n = 0;
+        uint8_t amplitude = 0;
+        for (size_t i = 0; i < count; i++) {
+            uint32_t ticks = steps[i].delayMs / tick;
+            int delta = int(steps[i].amplitude) - int(amplitude);
+
+            if (delta != 0 && ticks > 0) {
+                if (delta >= DELTA_MIN && delta <= DELTA_MAX) {
+                    if (out) out[n] = OP_DELTA | (uint8_t(delta) & ARG_MASK);
+                    n++;
+                    ticks -= 1;
+                } else {
+                    uint32_t run = ticks < MAX_RUN ? ticks : MAX_RUN;
+                    if (out) {
+                        out[n] = OP_SET | uint8_t(run - 1);
+                        out[n + 1] = steps[i].amplitude;
+                    }
+                    n += 2;
+                    ticks -= run;
+                }
+                amplitude = steps[i].amplitude;
+            }
+            while (ticks > 0) {
+                uint32_t run = ticks < MAX_RUN ? ticks : MAX_RUN;
+                if (out) out[n] = OP_REPEAT | uint8_t(run - 1);
+                n++;
+                ticks -= run;
+            }
+        }
+        return n;
+    }
+}
+
+template <size_t SIZE>
+struct EncodedEffect {
+    uint8_t timebaseMs;
+    uint8_t bytes[SIZE];
+};
+
+template <size_t N>
+constexpr size_t encodedSize(const HapticStep (&steps)[N]) {
+    return HapticCodec::encode(steps, N, HapticCodec::timebase(steps, N), nullptr);
+}
+
+template <size_t SIZE, size_t N>
+constexpr EncodedEffect<SIZE> encodeEffect(const HapticStep (&steps)[N]) {
+    static_assert(SIZE <= UINT16_MAX, "Encoded effect too long");
+    EncodedEffect<SIZE> coded {};
+    coded.timebaseMs = HapticCodec::timebase(steps, N);
+    HapticCodec::encode(steps, N, coded.timebaseMs, coded.bytes);
+    return coded;
+}
+
+template <size_t SIZE>
+constexpr HapticEffect makeEffect(const EncodedEffect<SIZE>& coded) {
+    return HapticEffect{HapticEffect::ENCODED, coded.timebaseMs, static_cast<uint16_t>(SIZE), coded.bytes};
+}
+
+/**
+ * @brief Streaming step source for any effect format
+ *
+ * Yields one HapticStep per call without expanding the effect in RAM.
+ * For encoded effects, runs that keep the same amplitude come out as a
+ * single longer step. Synth effects yield one step per tick, modulated by
+ * the optional live controls.
+ */
+class HapticDecoder {
+public:
+    HapticDecoder() = default;
+
+    explicit HapticDecoder(const HapticEffect& e, const SynthControls* synthControls = nullptr) {
+        reset(&e, synthControls);
+    }
+
+    // Start decoding another effect (e must outlive the decoder)
+    void reset(const HapticEffect* e, const SynthControls* synthControls = nullptr) {
+        effect = e;
+        controls = synthControls;
+        rewind();
+    }
+
+    bool next(HapticStep& out) {
+        if (effect == nullptr || pos >= effect->length) {
+            return false;
+        }
+        if (effect->format == HapticEffect::RAW_STEPS) {
+            out = static_cast<const HapticStep*>(effect->data)[pos++];
+            return true;
+        }
+        if (effect->format == HapticEffect::SYNTH) {
+            if (!synth.render(controls, amplitude)) {
+                pos = effect->length;
+                return false;
+            }
+            out.amplitude = amplitude;
+            out.delayMs = effect->timebaseMs;
+            return true;
+        }
+
+        const uint8_t* bytes = static_cast<const uint8_t*>(effect->data);
+        uint32_t ticks = readToken(bytes);
+        // Merge following repeats into this step
+        while (pos < effect->length && (bytes[pos] & HapticCodec::OP_MASK) == HapticCodec::OP_REPEAT) {
+            uint32_t run = (bytes[pos] & HapticCodec::ARG_MASK) + 1;
+            if ((ticks + run) * effect->timebaseMs > UINT16_MAX) {
+                break;
+            }
+            ticks += run;
+            pos++;
+        }
+        out.amplitude = amplitude;
+        out.delayMs = static_cast<uint16_t>(ticks * effect->timebaseMs);
+        return true;
+    }
+
+    void rewind() {
+        pos = 0;
+        amplitude = 0;
+        if (effect != nullptr && effect->format == HapticEffect::SYNTH) {
+            synth.reset(static_cast<const SynthPatch*>(effect->data));
+        }
+    }
+
+private:
+    const HapticEffect* effect = nullptr;
+    const SynthControls* controls = nullptr;
+    HapticSynth synth;
+    uint16_t pos = 0;
+    uint8_t amplitude = 0;
+
+    uint32_t readToken(const uint8_t* bytes) {
+        uint8_t token = bytes[pos++];
+        uint8_t arg = token & HapticCodec::ARG_MASK;
+        switch (token & HapticCodec::OP_MASK) {
+            case HapticCodec::OP_DELTA:
+                // Sign-extend the 6-bit delta
+                amplitude = static_cast<uint8_t>(amplitude + ((arg & 0x20) ? int(arg) - 64 : int(arg)));
+                return 1;
+            case HapticCodec::OP_REPEAT:
+                return arg + 1;
+            case HapticCodec::OP_SET:
+                amplitude = pos < effect->length ? bytes[pos++] : 0;
+                return arg + 1;
+            default:
+                // Reserved token: end the effect rather than play garbage
+                pos = effect->length;
+                return 0;
+        }
+    }
+};
@@ -1,14 +1,18 @@
-struct HapticStep {
-    uint8_t amplitude; // 0-255
-    uint16_t delayMs;  // hur länge denna amplitude ska spelas
-};
+#pragma once
+#include "hapticstep.h"
+#include "hapticcodec.h"
+#include "hapticsynth.h"
 
-using HapticEffect = std::vector<HapticStep>;
-const HapticEffect EFFECT_CONST_VIBE = {
-  {127, 10}
+// Constant level; raising the depth CC adds an 8 Hz tremolo
+constexpr SynthPatch EFFECT_CONST_VIBE_PATCH = {
+  SynthWave::SINE, 5,         // wave, tickMs
+  127, 0, 800,                // level, depth, rateCentiHz
+  0, 0, 255, 0, 0,            // attackMs, decayMs, sustain, holdMs, releaseMs
+  SynthWave::SINE, 0, 0, 0    // lfoWave, lfoRateCentiHz, lfoToRate, lfoToDepth
 };
+constexpr HapticEffect EFFECT_CONST_VIBE = makeEffect(EFFECT_CONST_VIBE_PATCH);
 
-const HapticEffect EFFECT_PULSE_PURR = {
+constexpr HapticStep EFFECT_PULSE_PURR_STEPS[] = {
   {77, 5},
   {94, 5},
   {107, 5},
@@ -231,8 +235,10 @@ const HapticEffect EFFECT_PULSE_PURR = {
   {127, 5},
   {77, 5}
 };
+constexpr auto EFFECT_PULSE_PURR_CODED = encodeEffect<encodedSize(EFFECT_PULSE_PURR_STEPS)>(EFFECT_PULSE_PURR_STEPS);
+constexpr HapticEffect EFFECT_PULSE_PURR = makeEffect(EFFECT_PULSE_PURR_CODED);
 
-const HapticEffect EFFECT_AUDIO_NOISE = {
+constexpr HapticStep EFFECT_AUDIO_NOISE_STEPS[] = {
   {83, 5},
   {73, 5},
   {76, 5},
@@ -388,8 +394,12 @@ const HapticEffect EFFECT_AUDIO_NOISE = {
   {106, 5},
   {127, 5}
 };
+constexpr auto EFFECT_AUDIO_NOISE_CODED = encodeEffect<encodedSize(EFFECT_AUDIO_NOISE_STEPS)>(EFFECT_AUDIO_NOISE_STEPS);
+constexpr HapticEffect EFFECT_AUDIO_NOISE = makeEffect(EFFECT_AUDIO_NOISE_CODED);
 
-const HapticEffect EFFECT_WAVE = {
+// 0 -> 127 -> 0 triangle with a 14 ms period. Kept as a table: the synth
+// triangle rises in steps of 18 and cannot reproduce it exactly.
+constexpr HapticStep EFFECT_WAVE_STEPS[] = {
   {0, 1},
   {20, 1},
   {40, 1},
@@ -405,8 +415,9 @@ const HapticEffect EFFECT_WAVE = {
   {40, 1},
   {20, 1}
 };
+constexpr HapticEffect EFFECT_WAVE = makeEffect(EFFECT_WAVE_STEPS);
 
-const HapticEffect EFFECT_BRADYCARDIA_HEAVY = {
+constexpr HapticStep EFFECT_BRADYCARDIA_HEAVY_STEPS[] = {
   {40, 60},
   {0, 30},
   {25, 40},
@@ -417,8 +428,10 @@ const HapticEffect EFFECT_BRADYCARDIA_HEAVY = {
   {30, 140},
   {0, 600}
 };
+constexpr auto EFFECT_BRADYCARDIA_HEAVY_CODED = encodeEffect<encodedSize(EFFECT_BRADYCARDIA_HEAVY_STEPS)>(EFFECT_BRADYCARDIA_HEAVY_STEPS);
+constexpr HapticEffect EFFECT_BRADYCARDIA_HEAVY = makeEffect(EFFECT_BRADYCARDIA_HEAVY_CODED);
 
-const HapticEffect EFFECT_STRONG_BUZZ = {
+constexpr HapticStep EFFECT_STRONG_BUZZ_STEPS[] = {
   {0, 10},
   {18, 10},
   {18, 10},
@@ -453,5 +466,27 @@ const HapticEffect EFFECT_STRONG_BUZZ = {
   {18, 10},
   {18, 10},
 };
+constexpr auto EFFECT_STRONG_BUZZ_CODED = encodeEffect<encodedSize(EFFECT_STRONG_BUZZ_STEPS)>(EFFECT_STRONG_BUZZ_STEPS);
+constexpr HapticEffect EFFECT_STRONG_BUZZ = makeEffect(EFFECT_STRONG_BUZZ_CODED);
 
+/**
+ * @brief Short accent played as a one-shot over the background effect
+ */
+constexpr HapticStep EFFECT_CLICK_STEPS[] = {
+  {110, 6},
+  {40, 4},
+};
+constexpr HapticEffect EFFECT_CLICK = makeEffect(EFFECT_CLICK_STEPS);
 
+/**
+ * @brief Effects selectable with the encoder, in encoder/LED order
+ */
+constexpr const HapticEffect* EFFECT_LIBRARY[] = {
+  &EFFECT_CONST_VIBE,
+  &EFFECT_PULSE_PURR,
+  &EFFECT_AUDIO_NOISE,
+  &EFFECT_WAVE,
+  &EFFECT_BRADYCARDIA_HEAVY,
+  &EFFECT_STRONG_BUZZ
+};
+constexpr uint8_t EFFECT_LIBRARY_SIZE = sizeof(EFFECT_LIBRARY) / sizeof(EFFECT_LIBRARY[0]);
@@ -0,0 +1,185 @@
+#pragma once
+#include <stdint.h>
+#include "hapticcodec.h"
+
+/**
+ * @brief Fixed-tick mixer summing several effects into one RTP value
+ *
+ * Voice 0 is the background texture selected with the encoder and loops.
+ * The other voices play one-shots (clicks, accents) on top of it. Every
+ * tick each voice advances through its effect, is scaled by its own gain
+ * and summed; the sum is scaled by the master volume and saturated to
+ * OUTPUT_MAX. All gains are Q15 (32768 = 1.0, up to ~2.0) and the whole
+ * path is integer arithmetic.
+ *
+ * Not thread safe: owned by the haptic task (see HapticPlayer).
+ */
+class HapticMixer {
+public:
+    static constexpr uint8_t NUM_VOICES = 4;
+    static constexpr uint8_t BACKGROUND_VOICE = 0;
+    static constexpr uint16_t UNITY_Q15 = 32768;
+    static constexpr uint8_t OUTPUT_MAX = 127;  // Full scale RTP used by our effects
+    static constexpr uint16_t MAX_EMPTY_STEPS = 256;  // Zero-length steps skipped per step boundary
+
+    /**
+     * @brief Start an effect on a voice right away
+     */
+    void play(uint8_t voice, const HapticEffect* effect, uint16_t gainQ15, bool looping,
+              const SynthControls* controls = nullptr) {
+        if (voice >= NUM_VOICES) return;
+        Voice& v = voices[voice];
+        v.effect = effect;
+        v.pending = effect;
+        v.gainQ15 = gainQ15;
+        v.looping = looping;
+        v.controls = controls;
+        v.amplitude = 0;
+        v.remainingUs = 0;
+        v.started = playCount++;
+        v.decoder.reset(effect, controls);
+    }
+
+    /**
+     * @brief Switch a looping voice at its next step boundary
+     *
+     * @return true if the voice was in the middle of another effect
+     */
+    bool queue(uint8_t voice, const HapticEffect* effect) {
+        if (voice >= NUM_VOICES) return false;
+        Voice& v = voices[voice];
+        bool interrupted = v.effect != nullptr && v.effect != effect;
+        v.pending = effect;
+        return interrupted;
+    }
+
+    /**
+     * @brief Play a one-shot on a free voice, stealing the oldest if needed
+     *
+     * The oldest is the one-shot voice started longest ago, so a click
+     * that just started is never cut for one that has nearly finished.
+     *
+     * @return The voice used
+     */
+    uint8_t playOneShot(const HapticEffect* effect, uint16_t gainQ15) {
+        uint8_t voice = 0;
+        for (uint8_t i = 1; i < NUM_VOICES; i++) {
+            if (voices[i].effect == nullptr) {
+                voice = i;
+                break;
+            }
+        }
+        if (voice == 0) {
+            voice = 1;
+            for (uint8_t i = 2; i < NUM_VOICES; i++) {
+                if ((int32_t)(voices[i].started - voices[voice].started) < 0) {
+                    voice = i;
+                }
+            }
+            steals++;
+        }
+        play(voice, effect, gainQ15, false);
+        return voice;
+    }
+
+    void setGain(uint8_t voice, uint16_t gainQ15) {
+        if (voice < NUM_VOICES) voices[voice].gainQ15 = gainQ15;
+    }
+
+    uint8_t activeVoices() const {
+        uint8_t n = 0;
+        for (uint8_t i = 0; i < NUM_VOICES; i++) {
+            if (voices[i].effect != nullptr) n++;
+        }
+        return n;
+    }
+
+    /**
+     * @brief Advance all voices by one tick and mix them
+     *
+     * @param tickUs Tick length; step durations are consumed in these units
+     * @param masterQ15 Master volume applied after summing
+     * @return Saturated RTP value for this tick
+     */
+    uint8_t render(uint32_t tickUs, uint16_t masterQ15) {
+        int32_t sum = 0;
+        for (uint8_t i = 0; i < NUM_VOICES; i++) {
+            Voice& v = voices[i];
+            if (v.remainingUs == 0) {
+                advance(v);
+            }
+            if (v.effect == nullptr) continue;
+
+            sum += (int32_t)v.amplitude * v.gainQ15;
+            v.remainingUs = v.remainingUs > tickUs ? v.remainingUs - tickUs : 0;
+        }
+
+        int32_t out = ((sum >> 15) * masterQ15) >> 15;
+        if (out > OUTPUT_MAX) {
+            clippedTicks++;
+            return OUTPUT_MAX;
+        }
+        return out < 0 ? 0 : (uint8_t)out;
+    }
+
+    uint32_t getClippedTicks() const { return clippedTicks; }
+    uint32_t getSteals() const { return steals; }
+
+private:
+    struct Voice {
+        const HapticEffect* effect = nullptr;   // Playing, nullptr = idle
+        const HapticEffect* pending = nullptr;  // Takes over at the next step boundary
+        const SynthControls* controls = nullptr;
+        HapticDecoder decoder;
+        uint16_t gainQ15 = UNITY_Q15;
+        uint8_t amplitude = 0;
+        uint32_t remainingUs = 0;
+        uint32_t started = 0;                   // playCount when it started, for stealing
+        bool looping = false;
+    };
+
+    Voice voices[NUM_VOICES];
+    uint32_t playCount = 0;
+    uint32_t clippedTicks = 0;
+    uint32_t steals = 0;
+
+    // Fetch the next step of a voice at a step boundary
+    void advance(Voice& v) {
+        if (v.pending != v.effect) {
+            v.effect = v.pending;
+            v.decoder.reset(v.effect, v.controls);
+        }
+        if (v.effect == nullptr) {
+            v.amplitude = 0;
+            return;
+        }
+
+        HapticStep step;
+        bool rewound = false;
+        // Zero-length steps are skipped; the bound only stops an effect that
+        // never produces time (a synth without a time base) from spinning
+        for (uint16_t skipped = 0; skipped < MAX_EMPTY_STEPS;) {
+            if (v.decoder.next(step)) {
+                if (step.delayMs == 0) {
+                    skipped++;
+                    continue;
+                }
+                v.amplitude = step.amplitude;
+                v.remainingUs = (uint32_t)step.delayMs * 1000;
+                return;
+            }
+            // Looping back to the start once is fine, twice means nothing to play
+            if (!v.looping || rewound) break;
+            v.decoder.rewind();
+            rewound = true;
+        }
+        // One-shot finished (or an effect with nothing to play). The
+        // background keeps its pending effect, so it restarts at the next
+        // tick instead of going silent until the encoder selects another.
+        v.effect = nullptr;
+        if (&v != &voices[BACKGROUND_VOICE]) {
+            v.pending = nullptr;
+        }
+        v.amplitude = 0;
+    }
+};
@@ -1,9 +1,16 @@
 #include <Arduino.h>
 #include <Adafruit_DRV2605.h>
-#include <vector>
-#include <memory>
+#include <esp_timer.h>
+#include <atomic>
 
 #include "hapticeffects.h"
+#include "hapticmixer.h"
+#include "jitterbuffer.h"
+#include "i2cbus.h"
+#include "registershadow.h"
+#include "steptiming.h"
+#include "touchchannel.h"
+#include "trace.h"
 
 // Initialize DRV2605L
 Adafruit_DRV2605 drv;
@@ -20,108 +27,592 @@ uint8_t olPeriodFromHz(float f) {
 
 float hapticVolume = 0.0;  // Default volume (0.0 to 1.0)
 
+/**
+ * @brief How the haptic task waits between mixer ticks
+ *
+ * - TickDelay: vTaskDelay() per tick, rounded to the FreeRTOS tick (legacy)
+ * - Timer:     an esp_timer one-shot wakes the task at each tick's absolute
+ *              deadline, so timing has microsecond resolution and
+ *              preemption does not accumulate as drift
+ */
+enum class PlaybackMode : uint8_t {
+    TickDelay,
+    Timer
+};
+
+/**
+ * @brief Playback parameters that can be driven by MIDI CC streams
+ */
+enum class HapticParam : uint8_t {
+    Volume,
+    SynthRate,
+    SynthDepth
+};
+
 // ----- HapticPlayer class -----
 class HapticPlayer {
 public:
+    // Render task priority in Timer mode: above the loop task and the BLE host,
+    // below the esp_timer task that wakes us
+    static constexpr UBaseType_t TIMER_TASK_PRIORITY = 18;
+    // Mixer tick; all effect step durations are whole milliseconds
+    static constexpr uint32_t TICK_US = 1000;
+
     HapticPlayer(BaseType_t core = 0)
-        : coreId(core), hapticVolume(1.0f), lastRealtimeValue(0) {
-        // Start with empty effect
-        currentEffect = std::make_shared<HapticEffect>();
+        : coreId(core), volumeQ15(HapticMixer::UNITY_Q15), lastRealtimeValue(0),
+          mode(PlaybackMode::Timer), taskHandle(nullptr) {
+        // Start with no effect (silence)
+        currentEffect.store(nullptr, std::memory_order_relaxed);
+        mixer.play(HapticMixer::BACKGROUND_VOICE, nullptr, HapticMixer::UNITY_Q15, true, &synthControls);
     }
 
-    void start() {
+    void start(PlaybackMode playbackMode = PlaybackMode::Timer) {
+        mode = playbackMode;
 
-        // Initialize DRV2605L
+        // Initialize DRV2605L (library calls run on the I2C bus task)
         Serial.println("Initializing DRV2605L...");
-        if (!drv.begin()) {
+        i2cBus.run(DRV2605_ADDR, [](void* arg) {
+            auto self = static_cast<HapticPlayer*>(arg);
+            self->driverFound = self->initDriver();
+        }, this, I2CPriority::Realtime);
+        if (!driverFound) {
           Serial.println("Could not find DRV2605L");
           while (1);
         }
 
-
-        // Set DRV to realtime mode for continuous playback in open-loop for LRA
-        // --- 1) Tell the chip it's an LRA (not ERM): FEEDBACK (0x1A), set bit7 ---
-        uint8_t fb = drv.readRegister8(0x1A);      
-        drv.writeRegister8(0x1A, fb | 0x80);       // N_ERM_LRA = 1 (LRA)
-
-        // --- 2) CONTROL3 (0x1D): LRA open-loop, unsigned RTP (0..127) ---
-        uint8_t c3 = drv.readRegister8(0x1D);      
-        c3 |= 0x01;                                // LRA_OPEN_LOOP = 1
-        c3 &= ~(1 << 5);                           // DATA_FORMAT_RTP = 0 (unsigned)
-        drv.writeRegister8(0x1D, c3);
-
-        // --- 3) Set open-loop LRA frequency ---
-        uint8_t ol = olPeriodFromHz(LRA_TARGET_HZ);
-        drv.writeRegister8(0x20, ol);
-
-        // --- 4) Set output clamp ---
-        drv.writeRegister8(0x17, 0x60);            
-
-        // --- 5) Enter RTP mode ---
-        drv.writeRegister8(0x01, 0x05);
-        
         Serial.println(F("Starting haptic background task..."));
         
+        if (mode == PlaybackMode::Timer && !clock.begin("haptic_step")) {
+            Serial.println(F("Could not create haptic step timer, falling back to tick delays"));
+            mode = PlaybackMode::TickDelay;
+        }
+
         xTaskCreatePinnedToCore(
             [](void* param) {
                 auto self = static_cast<HapticPlayer*>(param);
                 Serial.println(F("Haptic task started on core 0"));
+                self->clock.restart();
                 
                 while (true) {
-                    auto effect = self->currentEffect; // Get current effect (atomic)
+                    self->waitForTick();
+                    int64_t tickStartUs = esp_timer_get_time();
+                    
+                    // Pick up effect changes and one-shots from other tasks
+                    self->applyRequests();
+                    bool touchChanged = self->applyTouch();
                     
-                    if (effect && !effect->empty()) {
-                        // Play through the entire effect
-                        for (const auto& step : *effect) {
-                            // Scale amplitude by volume
-                            uint8_t scaledAmp = static_cast<uint8_t>(step.amplitude * self->hapticVolume);
-                            self->drv.setRealtimeValue(scaledAmp);
-                            self->lastRealtimeValue = scaledAmp;  // Store the value for debug access
-                            
-                            vTaskDelay(pdMS_TO_TICKS(step.delayMs));
+                    uint8_t value = self->mixer.render(TICK_US, self->volumeQ15);
+                    // Traced volume changes are stamped once the write is on the wire
+                    uint8_t traces = self->pendingTraces.exchange(0, std::memory_order_relaxed);
+                    // Only changes reach the bus
+                    if (self->drvShadow.write(0, DRV_RTP_INPUT, value)) {
+                        // Fire and forget on the highest bus priority; never block the tick
+                        if (!i2cBus.writeAsync(DRV2605_ADDR, DRV_RTP_INPUT, &value, 1, I2CPriority::Realtime, 0,
+                                               traces ? stampTraces : nullptr, (void*)(uintptr_t)traces)) {
+                            self->drvShadow.invalidate(0, DRV_RTP_INPUT);  // Dropped, retry next tick
+                            self->pendingTraces.fetch_or(traces, std::memory_order_relaxed);
                         }
-                    } else {
-                        // No effect or empty effect, just wait
-                        self->drv.setRealtimeValue(0);
-                        self->lastRealtimeValue = 0;  // Store the value for debug access
-                        vTaskDelay(pdMS_TO_TICKS(100));
+                        self->lastRealtimeValue = value;  // Store the value for debug access
+                    } else if (traces) {
+                        stampTraces(0, nullptr, 0, (void*)(uintptr_t)traces);  // Output already there
+                    }
+                    
+                    if (touchChanged) {
+                        self->recordTouchLatency();
                     }
+                    self->recordTickCost((int32_t)(esp_timer_get_time() - tickStartUs));
                 }
             },
             "HapticTask",
             4096,  // Stack size
             this,
-            1,     // Priority
-            nullptr,
+            mode == PlaybackMode::Timer ? TIMER_TASK_PRIORITY : 1,
+            &taskHandle,
             coreId
         );
     }
 
-    void setEffect(std::shared_ptr<HapticEffect> effect) {
-        currentEffect = effect; // Atomic pointer assignment
+    /**
+     * @brief Switch to another effect
+     * 
+     * Wait-free handoff: the effect tables are immutable and live for the
+     * whole program, so publishing a pointer is all the haptic task needs.
+     * It is picked up at the next step boundary, no copy or refcount involved.
+     * 
+     * @param effect Effect with static lifetime, or nullptr for silence
+     */
+    void setEffect(const HapticEffect* effect) {
+        currentEffect.store(effect, std::memory_order_release);
         Serial.println(F("Haptic effect changed"));
     }
 
+    /**
+     * @brief Play an effect once on top of the background effect
+     * 
+     * Requests go through a single-producer ring, so call this from one task
+     * only (the Arduino loop). Dropped if the ring is full.
+     * 
+     * @param effect Effect with static lifetime
+     * @param gainCC Voice gain as a MIDI CC value, 127 = unity
+     * @return false if the request was dropped
+     */
+    bool playOneShot(const HapticEffect* effect, uint8_t gainCC = 127) {
+        uint8_t head = oneShotHead.load(std::memory_order_relaxed);
+        uint8_t next = (head + 1) % ONE_SHOT_QUEUE_SIZE;
+        if (next == oneShotTail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        oneShotQueue[head] = {effect, ccToQ15(gainCC)};
+        oneShotHead.store(next, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Gain of the background voice relative to one-shots
+     */
+    void setBackgroundGain(uint8_t gainCC) {
+        backgroundGainQ15 = ccToQ15(gainCC);
+    }
+
+    /**
+     * @brief Live modulation of synth effects
+     * 
+     * @param cc Rate multiplier as a MIDI CC value, 64 = patch rate
+     */
+    void setSynthRate(uint8_t cc) {
+        synthControls.rateCC = min(cc, (uint8_t)127);
+    }
+
+    /**
+     * @param cc Depth offset as a MIDI CC value, 64 = patch depth
+     */
+    void setSynthDepth(uint8_t cc) {
+        synthControls.depthCC = min(cc, (uint8_t)127);
+    }
+
+    /**
+     * @brief Apply a parameter change right away
+     */
+    void setParam(HapticParam param, uint8_t value, TracePath trace = TracePath::None) {
+        if (param == HapticParam::Volume) {
+            markTrace(trace);
+        }
+        switch (param) {
+            case HapticParam::Volume:     setVolumeCC(value); break;
+            case HapticParam::SynthRate:  setSynthRate(value); break;
+            case HapticParam::SynthDepth: setSynthDepth(value); break;
+        }
+    }
+
+    /**
+     * @brief Apply a parameter change from a timestamped BLE-MIDI message
+     * 
+     * With the jitter buffer enabled the change is released by the haptic
+     * task on the sender's timeline plus the latency target; otherwise it is
+     * applied right away. Call from the MIDI sink only (single producer).
+     * 
+     * @param bleTimestamp 13-bit BLE-MIDI timestamp of the message
+     * @param trace Latency path stamped when a volume change reaches the driver
+     * @return true if the change was buffered
+     */
+    bool scheduleParam(HapticParam param, uint8_t value, uint16_t bleTimestamp,
+                       TracePath trace = TracePath::None) {
+        if (!jitterBuffer.enabled()) {
+            if (!jitterDraining.load(std::memory_order_acquire)) {
+                setParam(param, value, trace);
+                return false;
+            }
+            // Just disabled: queue behind the buffered changes so none applies out of order
+            jitterBuffer.pushNow((uint8_t)param, value, (uint8_t)trace, esp_timer_get_time());
+            return true;
+        }
+        jitterBuffer.push((uint8_t)param, value, (uint8_t)trace, bleTimestamp, esp_timer_get_time());
+        return true;
+    }
+
+    /**
+     * @brief Drive the volume straight from a touch input every tick
+     * 
+     * While set, each new reading of the channel becomes the master volume
+     * at the next tick, without going through MIDI. Volume changes from
+     * elsewhere (CC22 from Bluetooth) still apply until the touch value
+     * changes again.
+     * 
+     * @param channel Input to follow, or nullptr to turn touch-through off
+     */
+    void setTouchThrough(const TouchChannel* channel) {
+        touchSource.store(channel, std::memory_order_release);
+    }
+
+    bool isTouchThrough() const {
+        return touchSource.load(std::memory_order_acquire) != nullptr;
+    }
+
+    void printTouchStats(Stream& out) const {
+        StepTimingStats stats = getTimingStats();
+        out.print("Touch-through: ");
+        out.println(isTouchThrough() ? "on (FSR drives the haptic volume directly)" : "off (volume from CC22)");
+        out.print("  Updates: ");
+        out.print(stats.touchUpdates);
+        out.print(", reading-to-RTP latency avg: ");
+        out.print(stats.touchUpdates ? (uint32_t)(stats.totalTouchLatencyUs / stats.touchUpdates) : 0);
+        out.print(" us, max: ");
+        out.print(stats.maxTouchLatencyUs);
+        out.println(" us");
+    }
+
+    /**
+     * @brief Latency target of the BLE-MIDI jitter buffer, 0 = off
+     */
+    void setJitterLatency(uint16_t ms) {
+        if (ms == 0 && (jitterBuffer.depth() > 0 || jitterBuffer.hasHeld())) {
+            jitterDraining.store(true, std::memory_order_release);  // Cleared by the haptic task once empty
+        }
+        jitterBuffer.setLatencyMs(ms);
+    }
+
+    uint16_t getJitterLatency() const {
+        return jitterBuffer.getLatencyMs();
+    }
+
+    void resetJitterStats() {
+        jitterBuffer.resetStats();
+    }
+
+    void printJitterStats(Stream& out) const {
+        JitterBuffer::Stats stats = jitterBuffer.getStats();
+        out.print("BLE-MIDI jitter buffer: ");
+        if (jitterBuffer.enabled()) {
+            out.print(jitterBuffer.getLatencyMs());
+            out.println(" ms latency target");
+        } else {
+            out.println("off (events applied on arrival)");
+        }
+        out.print("  Queued: ");
+        out.print(stats.queued);
+        out.print(", played: ");
+        out.print(stats.played);
+        out.print(", depth: ");
+        out.print(jitterBuffer.depth());
+        out.print(" (max ");
+        out.print(stats.maxDepth);
+        out.print("/");
+        out.print(JitterBuffer::CAPACITY - 1);
+        out.println(")");
+        out.print("  Underruns (late): ");
+        out.print(stats.underruns);
+        out.print(", overruns (held newest): ");
+        out.print(stats.overruns);
+        out.print(", clock resyncs: ");
+        out.println(stats.resyncs);
+    }
+
+    uint32_t getEffectSwitchCount() const {
+        return effectSwitches;
+    }
+
     void setVolume(float vol) {
-        hapticVolume = constrain(vol, 0.0f, 1.0f);
+        volumeQ15 = (uint16_t)(constrain(vol, 0.0f, 1.0f) * HapticMixer::UNITY_Q15);
         //Serial.print(F("Haptic volume set to: "));
-        //Serial.println(hapticVolume);
+        //Serial.println(getVolume());
+    }
+
+    /**
+     * @brief Master volume straight from a MIDI CC value, no float on the way
+     */
+    void setVolumeCC(uint8_t cc) {
+        volumeQ15 = ccToQ15(cc);
     }
 
     float getVolume() const {
-        return hapticVolume;
+        return volumeQ15 / (float)HapticMixer::UNITY_Q15;
+    }
+
+    // Q15 gain for a CC value, 127 = 1.0
+    static uint16_t ccToQ15(uint8_t cc) {
+        if (cc > 127) cc = 127;
+        return (uint16_t)(((uint32_t)cc * HapticMixer::UNITY_Q15 + 63) / 127);
+    }
+
+    void printRegisterStats(Stream& out) const {
+        drvShadow.printStats(out, "Haptic driver (DRV2605L)");
     }
 
     uint8_t getLastSetRealtimeValue() const {
         return lastRealtimeValue;
     }
 
+    PlaybackMode getPlaybackMode() const {
+        return mode;
+    }
+
+    /**
+     * @brief Consistent copy of the step timing statistics
+     */
+    StepTimingStats getTimingStats() const {
+        return clock.getStats();
+    }
+
+    void resetTimingStats() {
+        clock.resetStats();
+    }
+
+    void printTimingStats(Stream& out) const {
+        StepTimingStats stats = getTimingStats();
+        out.print("Haptic playback: ");
+        out.println(mode == PlaybackMode::Timer ? "timer (absolute deadlines)" : "tick delay");
+        out.print("  Ticks: ");
+        out.print(stats.steps);
+        out.print(", resyncs: ");
+        out.print(stats.resyncs);
+        out.print(", mid-effect switches: ");
+        out.println(effectSwitches);
+        stats.printLateness(out);
+        stats.printCost(out, "Tick");
+        out.print("  Voices active: ");
+        out.print(activeVoices);
+        out.print("/");
+        out.print(HapticMixer::NUM_VOICES);
+        out.print(", clipped ticks: ");
+        out.print(clippedTicks);
+        out.print(", voice steals: ");
+        out.println(voiceSteals);
+        stats.printHistogram(out);
+    }
+
+    /**
+     * @brief Measure mixer cost for 1..NUM_VOICES busy voices
+     * 
+     * Runs a private mixer on the calling task, so playback is not affected.
+     * test/test_hapticmixer runs the same benchmark on the host.
+     */
+    void printMixerBenchmark(Stream& out) const {
+        const uint32_t ticks = 2000;
+        out.println("Mixer benchmark (2000 ticks per row):");
+        for (uint8_t voices = 1; voices <= HapticMixer::NUM_VOICES; voices++) {
+            HapticMixer bench;
+            SynthControls controls;
+            for (uint8_t v = 0; v < voices; v++) {
+                // Mix of synth, encoded and raw effects, all looping
+                bench.play(v, EFFECT_LIBRARY[v % EFFECT_LIBRARY_SIZE], HapticMixer::UNITY_Q15 / 2, true, &controls);
+            }
+            uint32_t checksum = 0;
+            int64_t t0 = esp_timer_get_time();
+            for (uint32_t t = 0; t < ticks; t++) {
+                checksum += bench.render(TICK_US, HapticMixer::UNITY_Q15);
+            }
+            int64_t elapsed = esp_timer_get_time() - t0;
+            out.print("  ");
+            out.print(voices);
+            out.print(" voice(s): ");
+            out.print((uint32_t)(elapsed * 1000 / ticks));
+            out.print(" ns/tick (checksum ");
+            out.print(checksum);
+            out.println(")");
+        }
+    }
+
 private:
+    static constexpr uint8_t ONE_SHOT_QUEUE_SIZE = 8;
+
+    struct OneShotRequest {
+        const HapticEffect* effect;
+        uint16_t gainQ15;
+    };
+
+    static constexpr uint8_t DRV_STATUS = 0x00;
+    static constexpr uint8_t DRV_RTP_INPUT = 0x02;  // Real-time playback input register
+    static constexpr uint8_t DRV_GO = 0x0C;         // Self-clearing
+
     Adafruit_DRV2605 drv;
+    RegisterShadow<1> drvShadow;  // Written by the bus task during init, then the haptic task
+    bool driverFound = false;
     BaseType_t coreId;
-    volatile float hapticVolume;
+    volatile uint16_t volumeQ15;      // Master volume, Q15
+    volatile uint16_t backgroundGainQ15 = HapticMixer::UNITY_Q15;
     volatile uint8_t lastRealtimeValue;
-    std::shared_ptr<HapticEffect> currentEffect;
+    std::atomic<const HapticEffect*> currentEffect;
+    volatile uint32_t effectSwitches = 0;  // Effects interrupted mid-way by setEffect()
+    SynthControls synthControls;
+    HapticMixer mixer;                     // Only touched by the haptic task
+    std::atomic<const TouchChannel*> touchSource{nullptr};
+    uint32_t lastTouchSequence = 0;        // Haptic task only
+    uint16_t lastTouchValue = 0xFFFF;
+    uint32_t touchTimeUs = 0;              // Time of the reading applied this tick
+    std::atomic<uint8_t> pendingTraces{0}; // Bit per TracePath with a volume change not yet written
+    JitterBuffer jitterBuffer;             // Timestamped CC changes from BLE-MIDI
+    std::atomic<bool> jitterDraining{false};  // Buffer disabled with events still queued
+    const HapticEffect* backgroundEffect = nullptr;
+
+    // Single-producer/single-consumer ring of one-shot requests
+    OneShotRequest oneShotQueue[ONE_SHOT_QUEUE_SIZE];
+    std::atomic<uint8_t> oneShotHead{0};
+    std::atomic<uint8_t> oneShotTail{0};
+
+    // Mixer counters mirrored for the CLI
+    volatile uint8_t activeVoices = 0;
+    volatile uint32_t clippedTicks = 0;
+    volatile uint32_t voiceSteals = 0;
+
+    PlaybackMode mode;
+    TaskHandle_t taskHandle;
+    DeadlineClock clock;              // Tick deadlines (Timer mode) and timing stats
+
+    // Runs on the I2C bus task, which owns Wire
+    bool initDriver() {
+        if (!drv.begin()) {
+            return false;
+        }
+        // begin() wrote registers behind our back
+        drvShadow.invalidate();
+        drvShadow.setVolatile(0, DRV_STATUS);
+        drvShadow.setVolatile(0, DRV_GO);
+
+        // Set DRV to realtime mode for continuous playback in open-loop for LRA
+        // --- 1) Tell the chip it's an LRA (not ERM): FEEDBACK (0x1A), set bit7 ---
+        uint8_t fb = drvRead(0x1A);      
+        drvWrite(0x1A, fb | 0x80);                 // N_ERM_LRA = 1 (LRA)
+
+        // --- 2) CONTROL3 (0x1D): LRA open-loop, unsigned RTP (0..127) ---
+        uint8_t c3 = drvRead(0x1D);      
+        c3 |= 0x01;                                // LRA_OPEN_LOOP = 1
+        c3 &= ~(1 << 5);                           // DATA_FORMAT_RTP = 0 (unsigned)
+        drvWrite(0x1D, c3);
+
+        // --- 3) Set open-loop LRA frequency ---
+        uint8_t ol = olPeriodFromHz(LRA_TARGET_HZ);
+        drvWrite(0x20, ol);
+
+        // --- 4) Set output clamp ---
+        drvWrite(0x17, 0x60);            
+
+        // --- 5) Enter RTP mode ---
+        drvWrite(0x01, 0x05);
+        return true;
+    }
+
+    // Register access through the shadow (bus task only, during init)
+    void drvWrite(uint8_t reg, uint8_t value) {
+        if (drvShadow.write(0, reg, value)) {
+            drv.writeRegister8(reg, value);
+        }
+    }
+
+    uint8_t drvRead(uint8_t reg) {
+        uint8_t value;
+        if (!drvShadow.read(0, reg, value)) {
+            value = drv.readRegister8(reg);
+            drvShadow.store(0, reg, value);
+        }
+        return value;
+    }
+
+    /**
+     * @brief Block until the next tick is due
+     *
+     * In Timer mode ticks have absolute deadlines (see DeadlineClock), so
+     * late wake-ups do not push the rest of the effect back.
+     */
+    void waitForTick() {
+        if (mode == PlaybackMode::TickDelay) {
+            vTaskDelay(pdMS_TO_TICKS(TICK_US / 1000));
+            return;
+        }
+
+        while (!clock.sleep()) {}
+        clock.advance(esp_timer_get_time(), TICK_US);
+    }
+
+    void recordTickCost(int32_t costUs) {
+        bool countStep = mode == PlaybackMode::TickDelay;  // No deadlines to count ticks in this mode
+        clock.updateStats([&](StepTimingStats& stats) {
+            if (countStep) stats.steps++;
+            stats.recordCost(costUs);
+        });
+
+        activeVoices = mixer.activeVoices();
+        clippedTicks = mixer.getClippedTicks();
+        voiceSteals = mixer.getSteals();
+    }
+
+    /**
+     * @brief Apply a new touch reading to the master volume
+     * 
+     * @return true if the volume changed this tick
+     */
+    bool applyTouch() {
+        const TouchChannel* channel = touchSource.load(std::memory_order_acquire);
+        TouchSample sample;
+        if (channel == nullptr || !channel->read(sample) || sample.sequence == lastTouchSequence) {
+            return false;
+        }
+        lastTouchSequence = sample.sequence;
+        if (sample.value == lastTouchValue) {
+            return false;
+        }
+        lastTouchValue = sample.value;
+        touchTimeUs = sample.timeUs;
+        volumeQ15 = (uint16_t)(((uint32_t)sample.value * HapticMixer::UNITY_Q15) / TouchChannel::MAX_VALUE);
+        markTrace(TracePath::FsrTouch);
+        return true;
+    }
+
+    void markTrace(TracePath path) {
+        if (path < TracePath::COUNT) {
+            pendingTraces.fetch_or(1 << (uint8_t)path, std::memory_order_relaxed);
+        }
+    }
+
+    // I2C completion callback (bus task): arg is the TracePath bit mask of the write
+    static void stampTraces(uint8_t, const uint8_t*, uint8_t, void* arg) {
+        uint8_t pending = (uint8_t)(uintptr_t)arg;
+        for (uint8_t p = 0; pending != 0; p++, pending >>= 1) {
+            if (pending & 1) {
+                tracer.stamp((TracePath)p, TraceStage::Actuator);
+            }
+        }
+    }
+
+    void recordTouchLatency() {
+        uint32_t latencyUs = (uint32_t)esp_timer_get_time() - touchTimeUs;
+        clock.updateStats([&](StepTimingStats& stats) {
+            stats.recordTouchLatency(latencyUs);
+        });
+    }
+
+    // Runs on the haptic task at the start of every tick
+    void applyRequests() {
+        const HapticEffect* effect = currentEffect.load(std::memory_order_acquire);
+        if (effect != backgroundEffect) {
+            if (mixer.queue(HapticMixer::BACKGROUND_VOICE, effect)) {
+                effectSwitches++;
+            }
+            backgroundEffect = effect;
+        }
+        // Buffered CC changes that are due by this tick
+        JitterBuffer::Event event;
+        int64_t nowUs = esp_timer_get_time();
+        while (jitterBuffer.pop(nowUs, event)) {
+            setParam((HapticParam)event.param, event.value, (TracePath)event.tag);
+        }
+        while (jitterBuffer.popHeld(event)) {
+            setParam((HapticParam)event.param, event.value, (TracePath)event.tag);
+        }
+        if (jitterDraining.load(std::memory_order_relaxed) && jitterBuffer.depth() == 0 &&
+            !jitterBuffer.hasHeld()) {
+            jitterDraining.store(false, std::memory_order_release);
+        }
+
+        mixer.setGain(HapticMixer::BACKGROUND_VOICE, backgroundGainQ15);
+
+        uint8_t tail = oneShotTail.load(std::memory_order_relaxed);
+        while (tail != oneShotHead.load(std::memory_order_acquire)) {
+            const OneShotRequest& request = oneShotQueue[tail];
+            mixer.playOneShot(request.effect, request.gainQ15);
+            tail = (tail + 1) % ONE_SHOT_QUEUE_SIZE;
+            oneShotTail.store(tail, std::memory_order_release);
+        }
+    }
 };
 
 
@@ -131,7 +622,7 @@ private:
   // Init (in setup())
   // Set initial haptic volume
   //player.setVolume(hapticVolume);
-  //player.setEffect(std::make_shared<HapticEffect>(EFFECT_CONST_VIBE));
+  //player.setEffect(&EFFECT_CONST_VIBE);
   
   // Start the background haptic task
   //player.start();
@@ -0,0 +1,47 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Packed so the tables cost 3 bytes per step instead of 4
+struct __attribute__((packed)) HapticStep {
+    uint8_t amplitude; // 0-255
+    uint16_t delayMs;  // hur länge denna amplitude ska spelas
+};
+static_assert(sizeof(HapticStep) == 3, "HapticStep must stay packed");
+
+/**
+ * @brief Read-only view of a constexpr effect table
+ *
+ * The tables are constexpr, so they end up in flash (.rodata) and need no
+ * constructors at boot. Switching effects just passes one of these views
+ * (or a pointer to it) around, nothing is allocated or copied.
+ *
+ * An effect is stored as plain steps, in the compact encoded format of
+ * hapticcodec.h, or as a synth patch (hapticsynth.h) rendered per tick.
+ * Use HapticDecoder to walk any of them.
+ */
+struct HapticEffect {
+    enum Format : uint8_t {
+        RAW_STEPS,  // data points to `length` HapticSteps
+        ENCODED,    // data points to `length` bytes, see hapticcodec.h
+        SYNTH       // data points to a SynthPatch of `length` bytes
+    };
+
+    Format format;
+    uint8_t timebaseMs;  // ENCODED/SYNTH: duration of one tick
+    uint16_t length;
+    const void* data;
+
+    constexpr bool empty() const { return length == 0; }
+
+    // Flash footprint of the effect data
+    constexpr size_t sizeBytes() const {
+        return format == RAW_STEPS ? length * sizeof(HapticStep) : length;
+    }
+};
+
+template <size_t N>
+constexpr HapticEffect makeEffect(const HapticStep (&steps)[N]) {
+    static_assert(N <= UINT16_MAX, "Effect table too long");
+    return HapticEffect{HapticEffect::RAW_STEPS, 0, static_cast<uint16_t>(N), steps};
+}
@@ -0,0 +1,198 @@
+#pragma once
+#include <stdint.h>
+#include "hapticstep.h"
+
+/**
+ * @brief Parametric haptic effects
+ *
+ * Instead of a sampled table, a SynthPatch describes an effect as an
+ * oscillator shaping the RTP amplitude, an ADSR envelope and an LFO that
+ * modulates oscillator rate and depth. HapticSynth renders one amplitude per
+ * tick using integer arithmetic only, so host and device produce the same
+ * output bit for bit.
+ *
+ * Rate and depth can be changed live through SynthControls (MIDI CC values,
+ * 64 = as written in the patch) without touching the patch in flash.
+ */
+enum class SynthWave : uint8_t {
+    SINE,
+    SQUARE,
+    SAW,
+    TRIANGLE,
+    NOISE       // Sample and hold, a new random level every period
+};
+
+struct SynthPatch {
+    SynthWave wave;
+    uint8_t tickMs;            // Render period
+    uint8_t level;             // Peak amplitude (RTP units)
+    uint8_t depth;             // 0 = constant level, 255 = full swing 0..level
+    uint16_t rateCentiHz;      // Oscillator rate in 0.01 Hz
+
+    // Envelope, scales the output; holdMs = 0 sustains forever
+    uint16_t attackMs;
+    uint16_t decayMs;
+    uint8_t sustain;           // 0-255 fraction of full level
+    uint16_t holdMs;           // Gate time before release starts
+    uint16_t releaseMs;
+
+    // LFO, modulates rate (vibrato) and depth (tremolo)
+    SynthWave lfoWave;
+    uint16_t lfoRateCentiHz;
+    uint8_t lfoToRate;         // 0-255: max rate deviation as a fraction of rate
+    uint8_t lfoToDepth;        // 0-255: max depth deviation in depth units
+};
+
+// Live modulation, written by the MIDI sink and read on every tick
+struct SynthControls {
+    volatile uint8_t rateCC = 64;   // Rate multiplier, 64 = x1, 127 = ~x2
+    volatile uint8_t depthCC = 64;  // Depth offset, 64 = patch depth
+};
+
+constexpr HapticEffect makeEffect(const SynthPatch& patch) {
+    return HapticEffect{HapticEffect::SYNTH, patch.tickMs, sizeof(SynthPatch), &patch};
+}
+
+class HapticSynth {
+public:
+    void reset(const SynthPatch* p) {
+        patch = p;
+        phase = 0;
+        lfoPhase = 0;
+        noiseState = 0xACE1u;
+        noiseValue = 0;
+        lfoNoiseValue = 0;
+        elapsedMs = 0;
+    }
+
+    /**
+     * @brief Render the amplitude for the next tick
+     *
+     * @return false once the envelope has released completely
+     */
+    bool render(const SynthControls* controls, uint8_t& amplitude) {
+        uint32_t env = envelope(elapsedMs);
+        if (patch->holdMs != 0 && elapsedMs >= (uint32_t)patch->holdMs + patch->releaseMs) {
+            return false;
+        }
+
+        uint8_t rateCC = controls ? controls->rateCC : 64;
+        uint8_t depthCC = controls ? controls->depthCC : 64;
+
+        // LFO first, as a bipolar Q15 value
+        int32_t lfo = (int32_t)oscillator(patch->lfoWave, lfoPhase, lfoNoiseValue) - 32768;
+        lfoPhase = advance(lfoPhase, patch->lfoRateCentiHz, lfoNoiseValue);
+
+        // Rate: CC scales it, the LFO deviates around it
+        int64_t rate = (int64_t)patch->rateCentiHz * rateCC / 64;
+        rate += (rate * patch->lfoToRate * lfo) >> (8 + 15);
+        if (rate < 0) rate = 0;
+
+        // Depth: CC offsets it, the LFO deviates around it
+        int32_t depth = (int32_t)patch->depth + ((int32_t)depthCC - 64) * 4;
+        depth += (patch->lfoToDepth * lfo) >> 15;
+        if (depth < 0) depth = 0;
+        if (depth > 255) depth = 255;
+
+        uint32_t osc = oscillator(patch->wave, phase, noiseValue);
+        phase = advance(phase, (uint32_t)rate, noiseValue);
+
+        // Q16 gain (65536 = 1.0): full at depth 0, follows the oscillator at depth 255
+        uint32_t gain = UNITY - ((uint32_t)depth * (65535 - osc)) / 255;
+        uint32_t value = ((uint32_t)patch->level * gain) >> 16;
+        amplitude = (uint8_t)((value * env) >> 16);
+
+        elapsedMs += patch->tickMs;
+        return true;
+    }
+
+private:
+    const SynthPatch* patch = nullptr;
+    uint32_t phase = 0;
+    uint32_t lfoPhase = 0;
+    uint16_t noiseState = 0xACE1u;
+    uint16_t noiseValue = 0;
+    uint16_t lfoNoiseValue = 0;
+    uint32_t elapsedMs = 0;
+
+    static constexpr uint32_t UNITY = 65536;
+
+    // sin(x) for the first quarter period, 64 steps, Q15
+    static constexpr int16_t SINE_QUARTER[65] = {
+            0,   804,  1608,  2410,  3212,  4011,  4808,  5602,
+         6393,  7179,  7962,  8739,  9512, 10278, 11039, 11793,
+        12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530,
+        18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594,
+        23170, 23731, 24279, 24811, 25329, 25832, 26319, 26790,
+        27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956,
+        30273, 30571, 30852, 31113, 31356, 31580, 31785, 31971,
+        32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757,
+        32767
+    };
+
+    // Unipolar Q16 (0-65535) oscillator output for a phase
+    static uint32_t oscillator(SynthWave wave, uint32_t ph, uint16_t noise) {
+        switch (wave) {
+            case SynthWave::SINE: {
+                uint8_t idx = ph >> 24;
+                uint8_t q = idx & 63;
+                int32_t s = (idx & 64) ? SINE_QUARTER[64 - q] : SINE_QUARTER[q];
+                if (idx & 128) s = -s;
+                int32_t u = 32768 + s;
+                return u > 65535 ? 65535 : (uint32_t)u;
+            }
+            case SynthWave::SQUARE:
+                return ph < 0x80000000u ? 65535 : 0;
+            case SynthWave::SAW:
+                return ph >> 16;
+            case SynthWave::TRIANGLE: {
+                uint32_t p = ph >> 15;
+                return p < 65536 ? p : 131071 - p;
+            }
+            case SynthWave::NOISE:
+            default:
+                return noise;
+        }
+    }
+
+    // Step a phase accumulator by one tick; draws new noise on wrap
+    uint32_t advance(uint32_t ph, uint32_t rateCentiHz, uint16_t& noise) {
+        uint32_t inc = (uint32_t)(((uint64_t)rateCentiHz * patch->tickMs << 32) / 100000);
+        uint32_t next = ph + inc;
+        if (next < ph) {
+            noise = nextNoise();
+        }
+        return next;
+    }
+
+    uint16_t nextNoise() {
+        // 16-bit xorshift, deterministic on every platform
+        noiseState ^= noiseState << 7;
+        noiseState ^= noiseState >> 9;
+        noiseState ^= noiseState << 8;
+        return noiseState;
+    }
+
+    // ADSR gain in Q16 (65536 = 1.0) at time t
+    uint32_t envelope(uint32_t t) const {
+        if (patch->holdMs != 0 && t >= patch->holdMs) {
+            uint32_t start = attackDecay(patch->holdMs);
+            uint32_t r = t - patch->holdMs;
+            if (patch->releaseMs == 0 || r >= patch->releaseMs) return 0;
+            return start - (start * r) / patch->releaseMs;
+        }
+        return attackDecay(t);
+    }
+
+    uint32_t attackDecay(uint32_t t) const {
+        uint32_t sustain = ((uint32_t)patch->sustain * UNITY + 127) / 255;
+        if (t < patch->attackMs) {
+            return (UNITY * t) / patch->attackMs;
+        }
+        t -= patch->attackMs;
+        if (t < patch->decayMs) {
+            return UNITY - ((UNITY - sustain) * t) / patch->decayMs;
+        }
+        return sustain;
+    }
+};
@@ -0,0 +1,161 @@
+#pragma once
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <atomic>
+
+/**
+ * @brief High-resolution heat PWM with sigma-delta dithering
+ *
+ * The LEDC runs at PWM_BITS (12-bit, fine up to ~19 kHz). Duties are set
+ * with DUTY_BITS (16-bit): the top PWM_BITS go to the hardware and the
+ * remaining DITHER_BITS are dithered over time by a first-order
+ * sigma-delta, so the average duty has the full resolution. A 1 kHz
+ * esp_timer adds the fraction to an accumulator and writes floor + 1
+ * whenever it carries; the hardware only picks up a new duty at a period
+ * boundary, so each value lasts at least one whole PWM period.
+ *
+ * The lowest settings benefit most: 1% duty is 41 hardware steps at
+ * 12-bit, 2.6 at the old 8-bit; with dithering it is 655 steps.
+ *
+ * setDuty() writes the integer part straight away, so changes (and off)
+ * never wait for the timer. The timer rewrites the duty every period
+ * from the target, so it needs no shared state with setDuty() beyond
+ * the target itself; a write racing a setDuty() is corrected 1 ms later.
+ */
+class HeatOutput {
+public:
+    static constexpr uint8_t PWM_BITS = 12;
+    static constexpr uint8_t DITHER_BITS = 4;
+    static constexpr uint8_t DUTY_BITS = PWM_BITS + DITHER_BITS;
+    static constexpr uint32_t PWM_MAX = (1UL << PWM_BITS) - 1;
+    static constexpr uint32_t DUTY_MAX = (1UL << DUTY_BITS) - 1;
+    static constexpr uint32_t DITHER_PERIOD_US = 1000;
+
+    HeatOutput(uint8_t pin, uint8_t channel) : pin(pin), channel(channel) {}
+
+    /**
+     * @brief Set up the LEDC channel (output off) and start dithering
+     */
+    void begin(double frequency) {
+        this->frequency = ledcSetup(channel, frequency, PWM_BITS);
+        ledcAttachPin(pin, channel);
+        ledcWrite(channel, 0);
+
+        esp_timer_create_args_t timerArgs = {};
+        timerArgs.callback = &HeatOutput::onDitherTimer;
+        timerArgs.arg = this;
+        timerArgs.dispatch_method = ESP_TIMER_TASK;
+        timerArgs.name = "heat_dither";
+        if (esp_timer_create(&timerArgs, &ditherTimer) != ESP_OK ||
+            esp_timer_start_periodic(ditherTimer, DITHER_PERIOD_US) != ESP_OK) {
+            Serial.println(F("Heat output: no dither timer, running at 12-bit"));
+            ditherTimer = nullptr;
+        }
+    }
+
+    /**
+     * @brief Retune the PWM frequency, keeping the duty
+     *
+     * @return The frequency set, 0 on failure
+     */
+    double setFrequency(double newFrequency) {
+        double actual = ledcChangeFrequency(channel, newFrequency, PWM_BITS);
+        if (actual > 0) {
+            frequency = actual;
+        }
+        return actual;
+    }
+
+    double getFrequency() const { return frequency; }
+
+    /**
+     * @param duty 0..1
+     */
+    void setDuty(float duty) {
+        if (duty <= 0) {
+            setDutyRaw(0);
+        } else if (duty >= 1) {
+            setDutyRaw(DUTY_MAX);
+        } else {
+            setDutyRaw((uint32_t)lroundf(duty * DUTY_MAX));
+        }
+    }
+
+    /**
+     * @param duty 0..DUTY_MAX
+     */
+    void setDutyRaw(uint32_t duty) {
+        if (duty > DUTY_MAX) duty = DUTY_MAX;
+        if (!dithering) {
+            duty = (duty + (1 << (DITHER_BITS - 1))) & ~((1UL << DITHER_BITS) - 1);  // Round to PWM_BITS
+            if (duty > DUTY_MAX) duty = DUTY_MAX & ~((1UL << DITHER_BITS) - 1);
+        }
+        targetDuty.store(duty, std::memory_order_relaxed);
+        ledcWrite(channel, hardwareDuty(duty));
+    }
+
+    float getDuty() const {
+        return targetDuty.load(std::memory_order_relaxed) / (float)DUTY_MAX;
+    }
+
+    uint32_t getDutyRaw() const {
+        return targetDuty.load(std::memory_order_relaxed);
+    }
+
+    void setDithering(bool on) {
+        dithering = on;
+        setDutyRaw(getDutyRaw());
+    }
+
+    bool isDithering() const { return dithering && ditherTimer != nullptr; }
+
+    void printStats(Stream& out) const {
+        out.print("Heat output: ");
+        out.print(frequency, 1);
+        out.print(" Hz, ");
+        out.print(PWM_BITS);
+        out.print("-bit PWM");
+        if (isDithering()) {
+            out.print(" + ");
+            out.print(DITHER_BITS);
+            out.print("-bit sigma-delta");
+        }
+        out.println();
+        out.print("  Duty ");
+        out.print(getDutyRaw());
+        out.print("/");
+        out.print(DUTY_MAX);
+        out.print(" (");
+        out.print(getDuty() * 100, 3);
+        out.println("%)");
+    }
+
+private:
+    uint8_t pin;
+    uint8_t channel;
+    double frequency = 0;
+    esp_timer_handle_t ditherTimer = nullptr;
+    volatile bool dithering = true;
+    std::atomic<uint32_t> targetDuty{0};
+    uint32_t accumulator = 0;         // Dither timer only
+
+    static uint32_t hardwareDuty(uint32_t duty) {
+        uint32_t hw = duty >> DITHER_BITS;
+        return hw > PWM_MAX ? PWM_MAX : hw;
+    }
+
+    // Runs in the esp_timer task
+    static void onDitherTimer(void* arg) {
+        auto self = static_cast<HeatOutput*>(arg);
+        uint32_t duty = self->targetDuty.load(std::memory_order_relaxed);
+        uint32_t fraction = duty & ((1UL << DITHER_BITS) - 1);
+        uint32_t hw = hardwareDuty(duty);
+
+        self->accumulator += fraction;
+        if (self->accumulator >= (1UL << DITHER_BITS)) {
+            self->accumulator -= 1UL << DITHER_BITS;
+            if (hw < PWM_MAX) hw++;
+        }
+        ledcWrite(self->channel, hw);
+    }
+};
@@ -0,0 +1,278 @@
+#include "i2cbus.h"
+#include <esp_timer.h>
+
+I2CBus i2cBus;
+
+void I2CBus::begin(uint32_t clockHz, UBaseType_t priority, BaseType_t core) {
+    if (task != nullptr) {
+        return;
+    }
+    Wire.begin();
+    Wire.setClock(clockHz);
+
+    for (uint8_t p = 0; p < (uint8_t)I2CPriority::COUNT; p++) {
+        queues[p] = xQueueCreate(QUEUE_LENGTHS[p], sizeof(Transaction));
+    }
+    uint32_t total = 0;
+    for (uint8_t p = 0; p < (uint8_t)I2CPriority::COUNT; p++) {
+        total += QUEUE_LENGTHS[p];
+    }
+    pending = xSemaphoreCreateCounting(total, 0);
+
+    xTaskCreatePinnedToCore(taskLoop, "I2CBus", 4096, this, priority, &task, core);
+}
+
+bool I2CBus::writeAsync(uint8_t address, uint8_t reg, const uint8_t* data, uint8_t length,
+                        I2CPriority priority, TickType_t wait, Callback callback, void* callbackArg) {
+    if (length >= MAX_PAYLOAD) {
+        return false;
+    }
+    Transaction t = {};
+    t.address = address;
+    t.priority = (uint8_t)priority;
+    t.writeLength = length + 1;
+    t.data[0] = reg;
+    memcpy(t.data + 1, data, length);
+    t.callback = callback;
+    t.callbackArg = callbackArg;
+    return submit(t, wait);
+}
+
+bool I2CBus::readAsync(uint8_t address, uint8_t reg, uint8_t length, Callback callback, void* callbackArg,
+                       I2CPriority priority) {
+    if (length > MAX_PAYLOAD) {
+        return false;
+    }
+    Transaction t = {};
+    t.address = address;
+    t.priority = (uint8_t)priority;
+    t.writeLength = 1;
+    t.readLength = length;
+    t.data[0] = reg;
+    t.callback = callback;
+    t.callbackArg = callbackArg;
+    return submit(t, portMAX_DELAY);
+}
+
+uint8_t I2CBus::write(uint8_t address, uint8_t reg, const uint8_t* data, uint8_t length, I2CPriority priority) {
+    if (length >= MAX_PAYLOAD) {
+        return STATUS_QUEUE_FULL;
+    }
+    Transaction t = {};
+    t.address = address;
+    t.priority = (uint8_t)priority;
+    t.writeLength = length + 1;
+    t.data[0] = reg;
+    memcpy(t.data + 1, data, length);
+    return submitAndWait(t);
+}
+
+uint8_t I2CBus::read(uint8_t address, uint8_t reg, uint8_t* data, uint8_t length, I2CPriority priority) {
+    if (length > MAX_PAYLOAD) {
+        return STATUS_QUEUE_FULL;
+    }
+    Transaction t = {};
+    t.address = address;
+    t.priority = (uint8_t)priority;
+    t.writeLength = 1;
+    t.readLength = length;
+    t.data[0] = reg;
+    t.readBuffer = data;
+    return submitAndWait(t);
+}
+
+bool I2CBus::probe(uint8_t address) {
+    Transaction t = {};
+    t.address = address;
+    t.priority = (uint8_t)I2CPriority::Normal;
+    return submitAndWait(t) == 0;
+}
+
+void I2CBus::run(uint8_t address, Job job, void* arg, I2CPriority priority) {
+    Transaction t = {};
+    t.address = address;
+    t.priority = (uint8_t)priority;
+    t.job = job;
+    t.jobArg = arg;
+    submitAndWait(t);
+}
+
+bool I2CBus::runInline() const {
+    return task == nullptr || xTaskGetCurrentTaskHandle() == task;
+}
+
+bool I2CBus::submit(Transaction& t, TickType_t wait) {
+    if (runInline()) {
+        execute(t);
+        return true;
+    }
+    QueueStats& q = queueStats[t.priority];
+    t.queuedUs = esp_timer_get_time();
+    if (xQueueSendToBack(queues[t.priority], &t, wait) != pdTRUE) {
+        q.dropped++;
+        return false;
+    }
+    xSemaphoreGive(pending);
+    return true;
+}
+
+uint8_t I2CBus::submitAndWait(Transaction& t) {
+    uint8_t status = STATUS_QUEUE_FULL;
+    t.status = &status;
+    if (runInline()) {
+        execute(t);
+        return status;
+    }
+    t.waiter = xTaskGetCurrentTaskHandle();
+    if (submit(t, portMAX_DELAY)) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+    return status;
+}
+
+void I2CBus::execute(Transaction& t) {
+    uint8_t readData[MAX_PAYLOAD];
+    uint8_t status = 0;
+    int64_t startUs = esp_timer_get_time();
+
+    if (t.job != nullptr) {
+        t.job(t.jobArg);
+    } else {
+        Wire.beginTransmission(t.address);
+        Wire.write(t.data, t.writeLength);
+        status = Wire.endTransmission(t.readLength == 0);
+        if (status == 0 && t.readLength > 0) {
+            uint8_t received = Wire.requestFrom(t.address, t.readLength);
+            for (uint8_t i = 0; i < received && i < t.readLength; i++) {
+                readData[i] = Wire.read();
+            }
+            if (received != t.readLength) {
+                status = 4;  // Same code Wire uses for "other error"
+            }
+        }
+    }
+
+    uint32_t busUs = (uint32_t)(esp_timer_get_time() - startUs);
+    account(t, status, busUs);
+
+    if (t.readBuffer != nullptr && status == 0) {
+        memcpy(t.readBuffer, readData, t.readLength);
+    }
+    if (t.callback != nullptr) {
+        t.callback(status, readData, status == 0 ? t.readLength : 0, t.callbackArg);
+    }
+    if (t.status != nullptr) {
+        *t.status = status;
+    }
+    if (t.waiter != nullptr) {
+        xTaskNotifyGive(t.waiter);
+    }
+}
+
+void I2CBus::account(const Transaction& t, uint8_t status, uint32_t busUs) {
+    if (resetRequested) {
+        memset(devices, 0, sizeof(devices));
+        memset(queueStats, 0, sizeof(queueStats));
+        resetRequested = false;
+    }
+
+    if (t.queuedUs != 0) {
+        QueueStats& q = queueStats[t.priority];
+        uint32_t waitUs = (uint32_t)(esp_timer_get_time() - busUs - t.queuedUs);
+        q.transactions++;
+        if (waitUs > q.maxWaitUs) q.maxWaitUs = waitUs;
+    }
+
+    for (uint8_t i = 0; i < MAX_DEVICES; i++) {
+        DeviceStats& d = devices[i];
+        if (d.transactions != 0 && d.address != t.address) {
+            continue;
+        }
+        // First free slot or the slot of this address
+        d.address = t.address;
+        d.transactions++;
+        if (status != 0) d.errors++;
+        d.busTimeUs += busUs;
+        if (busUs > d.maxTimeUs) d.maxTimeUs = busUs;
+        return;
+    }
+}
+
+void I2CBus::taskLoop(void* param) {
+    auto self = static_cast<I2CBus*>(param);
+    Transaction t;
+
+    while (true) {
+        xSemaphoreTake(self->pending, portMAX_DELAY);
+
+        // Highest priority first; the semaphore guarantees one is waiting
+        for (uint8_t p = 0; p < (uint8_t)I2CPriority::COUNT; p++) {
+            UBaseType_t depth = uxQueueMessagesWaiting(self->queues[p]);
+            if (depth > self->queueStats[p].maxDepth) {
+                self->queueStats[p].maxDepth = depth;
+            }
+            if (xQueueReceive(self->queues[p], &t, 0) == pdTRUE) {
+                self->execute(t);
+                break;
+            }
+        }
+    }
+}
+
+bool I2CBus::getDeviceStats(uint8_t index, DeviceStats& out) const {
+    if (index >= MAX_DEVICES || devices[index].transactions == 0) {
+        return false;
+    }
+    out = devices[index];
+    return true;
+}
+
+I2CBus::QueueStats I2CBus::getQueueStats(I2CPriority priority) const {
+    return queueStats[(uint8_t)priority];
+}
+
+void I2CBus::resetStats() {
+    resetRequested = true;
+}
+
+void I2CBus::printStats(Stream& out) const {
+    static const char* const PRIORITY_NAMES[] = {"realtime", "normal", "background"};
+
+    out.println("I2C bus queues:");
+    for (uint8_t p = 0; p < (uint8_t)I2CPriority::COUNT; p++) {
+        QueueStats q = queueStats[p];
+        out.print("  ");
+        out.print(PRIORITY_NAMES[p]);
+        out.print(": ");
+        out.print(q.transactions);
+        out.print(" queued, max wait ");
+        out.print(q.maxWaitUs);
+        out.print(" us, max depth ");
+        out.print(q.maxDepth);
+        out.print("/");
+        out.print(QUEUE_LENGTHS[p]);
+        out.print(", dropped ");
+        out.println(q.dropped);
+    }
+
+    out.println("I2C bus time per device:");
+    for (uint8_t i = 0; i < MAX_DEVICES; i++) {
+        DeviceStats d;
+        if (!getDeviceStats(i, d)) {
+            continue;
+        }
+        out.print("  0x");
+        if (d.address < 16) out.print("0");
+        out.print(d.address, HEX);
+        out.print(": ");
+        out.print(d.transactions);
+        out.print(" transactions, ");
+        out.print((uint32_t)(d.busTimeUs / 1000));
+        out.print(" ms total, avg ");
+        out.print((uint32_t)(d.busTimeUs / d.transactions));
+        out.print(" us, max ");
+        out.print(d.maxTimeUs);
+        out.print(" us, errors ");
+        out.println(d.errors);
+    }
+}
@@ -0,0 +1,171 @@
+#pragma once
+#include <Arduino.h>
+#include <Wire.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+/**
+ * @brief Transaction priority on the shared I2C bus
+ *
+ * The bus task always serves the highest non-empty queue first. A running
+ * transaction is never interrupted, so large transfers should be split
+ * (see LEDRingSmall::writeBuff) to keep Realtime latency bounded.
+ */
+enum class I2CPriority : uint8_t {
+    Realtime,    // Haptic RTP writes
+    Normal,      // Sensors
+    Background,  // LED ring
+    COUNT
+};
+
+/**
+ * @brief Single owner of the I2C peripheral
+ *
+ * All tasks submit transactions to a bus task instead of calling Wire
+ * directly. Transactions are copied into per-priority FreeRTOS queues, so
+ * fire-and-forget writes can be posted from any task without waiting.
+ *
+ * - writeAsync()/readAsync(): queued, optional completion callback that
+ *   runs on the bus task
+ * - write()/read(): block the caller until done, using its task
+ *   notification (do not call from tasks that wait on notifications for
+ *   other reasons, e.g. the haptic task)
+ * - run(): execute a driver library call (Adafruit_* objects use Wire
+ *   internally) on the bus task with exclusive access to the bus
+ *
+ * Before begin() and on the bus task itself everything runs inline.
+ *
+ * Bus time is accounted per device address and queue waits per priority.
+ */
+class I2CBus {
+public:
+    static constexpr uint8_t MAX_PAYLOAD = 32;  // Register + data bytes per transaction
+    static constexpr uint8_t MAX_DEVICES = 8;   // Addresses with separate accounting
+    static constexpr uint8_t STATUS_QUEUE_FULL = 0xF0;
+
+    typedef void (*Job)(void* arg);
+    typedef void (*Callback)(uint8_t status, const uint8_t* data, uint8_t length, void* arg);
+
+    struct DeviceStats {
+        uint8_t address;
+        uint32_t transactions;
+        uint32_t errors;
+        uint64_t busTimeUs;
+        uint32_t maxTimeUs;
+    };
+
+    struct QueueStats {
+        uint32_t transactions;
+        uint32_t dropped;
+        uint32_t maxWaitUs;
+        uint8_t maxDepth;
+    };
+
+    /**
+     * @brief Start the bus and its task
+     *
+     * Safe to call more than once; later calls do nothing.
+     */
+    void begin(uint32_t clockHz = 400000, UBaseType_t priority = 19, BaseType_t core = 0);
+
+    bool isRunning() const { return task != nullptr; }
+
+    /**
+     * @brief Queue a register write
+     *
+     * @param wait Ticks to wait for queue space, 0 = drop if full
+     * @return false if the transaction was dropped
+     */
+    bool writeAsync(uint8_t address, uint8_t reg, const uint8_t* data, uint8_t length,
+                    I2CPriority priority = I2CPriority::Normal, TickType_t wait = portMAX_DELAY,
+                    Callback callback = nullptr, void* callbackArg = nullptr);
+
+    bool writeAsync(uint8_t address, uint8_t reg, uint8_t value,
+                    I2CPriority priority = I2CPriority::Normal, TickType_t wait = portMAX_DELAY) {
+        return writeAsync(address, reg, &value, 1, priority, wait);
+    }
+
+    /**
+     * @brief Queue a register read; the data is passed to the callback
+     */
+    bool readAsync(uint8_t address, uint8_t reg, uint8_t length, Callback callback, void* callbackArg,
+                   I2CPriority priority = I2CPriority::Normal);
+
+    /**
+     * @brief Blocking register write
+     *
+     * @return Wire status (0 = success)
+     */
+    uint8_t write(uint8_t address, uint8_t reg, const uint8_t* data, uint8_t length,
+                  I2CPriority priority = I2CPriority::Normal);
+
+    uint8_t write(uint8_t address, uint8_t reg, uint8_t value, I2CPriority priority = I2CPriority::Normal) {
+        return write(address, reg, &value, 1, priority);
+    }
+
+    /**
+     * @brief Blocking register read (write register, repeated start, read)
+     *
+     * @return Wire status (0 = success)
+     */
+    uint8_t read(uint8_t address, uint8_t reg, uint8_t* data, uint8_t length,
+                 I2CPriority priority = I2CPriority::Normal);
+
+    /**
+     * @brief Check whether a device acknowledges its address
+     */
+    bool probe(uint8_t address);
+
+    /**
+     * @brief Run a driver call on the bus task and wait for it
+     *
+     * @param address Device the job talks to, for bus time accounting
+     */
+    void run(uint8_t address, Job job, void* arg, I2CPriority priority = I2CPriority::Normal);
+
+    /**
+     * @brief Accounting for one device, false if it has not been used
+     */
+    bool getDeviceStats(uint8_t index, DeviceStats& out) const;
+    QueueStats getQueueStats(I2CPriority priority) const;
+    void resetStats();
+    void printStats(Stream& out) const;
+
+private:
+    struct Transaction {
+        uint8_t address;
+        uint8_t writeLength;   // Bytes of data[] to write (register first)
+        uint8_t readLength;    // Bytes to read after the write
+        uint8_t priority;
+        Job job;
+        void* jobArg;
+        Callback callback;
+        void* callbackArg;
+        TaskHandle_t waiter;   // Notified when done (blocking calls)
+        uint8_t* status;       // Filled in before the waiter is notified
+        uint8_t* readBuffer;   // Blocking reads copy here
+        int64_t queuedUs;
+        uint8_t data[MAX_PAYLOAD];
+    };
+
+    static constexpr uint8_t QUEUE_LENGTHS[(uint8_t)I2CPriority::COUNT] = {8, 16, 24};
+
+    TaskHandle_t task = nullptr;
+    QueueHandle_t queues[(uint8_t)I2CPriority::COUNT] = {};
+    SemaphoreHandle_t pending = nullptr;  // Counts queued transactions over all queues
+
+    DeviceStats devices[MAX_DEVICES] = {};
+    QueueStats queueStats[(uint8_t)I2CPriority::COUNT] = {};
+    volatile bool resetRequested = false;
+
+    bool submit(Transaction& t, TickType_t wait);
+    uint8_t submitAndWait(Transaction& t);
+    bool runInline() const;
+    void execute(Transaction& t);
+    void account(const Transaction& t, uint8_t status, uint32_t busUs);
+    static void taskLoop(void* param);
+};
+
+extern I2CBus i2cBus;
@@ -0,0 +1,246 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * @brief Jitter buffer for timestamped BLE-MIDI control events
+ *
+ * BLE delivers MIDI in bursts, one packet per connection interval, so a
+ * steady CC stream arrives bunched up. Every BLE-MIDI message carries a
+ * 13-bit millisecond timestamp from the sender's clock. The buffer maps
+ * that clock onto ours and releases each event at
+ *
+ *   sender time + smallest transport delay seen + latency target
+ *
+ * so the spacing of the original stream is restored at the cost of a
+ * fixed delay. The smallest delay is tracked with a slow upward creep so
+ * the mapping follows clock drift between the two devices.
+ *
+ * One producer (the MIDI sink, Arduino loop) and one consumer (the haptic
+ * task); push() and pop() are lock-free.
+ *
+ * - Underrun: an event arrived after its release time (the latency target
+ *   is shorter than the jitter). It is released immediately.
+ * - Overrun: the buffer was full. The newest value of each param is held
+ *   outside the ring (later changes of that param replace it) and
+ *   released by popHeld() once the ring has drained, so the last value
+ *   of a stream is never lost.
+ */
+class JitterBuffer {
+public:
+    static constexpr uint8_t CAPACITY = 32;
+    static constexpr uint16_t DEFAULT_LATENCY_MS = 40;
+    static constexpr uint16_t MAX_LATENCY_MS = 500;
+    static constexpr uint8_t MAX_PARAMS = 4;  // Params that can be held on overrun
+
+    struct Event {
+        int64_t dueUs;     // Local time to apply the event
+        uint8_t param;     // Opaque to the buffer
+        uint8_t value;
+        uint8_t tag;       // Opaque, travels with the event (latency trace path)
+    };
+
+    struct Stats {
+        uint32_t queued;
+        uint32_t played;
+        uint32_t underruns;
+        uint32_t overruns;
+        uint32_t resyncs;
+        uint8_t maxDepth;
+    };
+
+    /**
+     * @brief Set the latency target; 0 disables buffering
+     */
+    void setLatencyMs(uint16_t ms) {
+        latencyMs = ms > MAX_LATENCY_MS ? MAX_LATENCY_MS : ms;
+        resyncRequested = true;
+    }
+
+    uint16_t getLatencyMs() const { return latencyMs; }
+    bool enabled() const { return latencyMs != 0; }
+
+    /**
+     * @brief Queue an event (producer side)
+     *
+     * @param timestamp BLE-MIDI timestamp of the message (13 bits, ms)
+     * @param nowUs Local arrival time
+     * @return false if the buffer was full and the event was held instead
+     */
+    bool push(uint8_t param, uint8_t value, uint8_t tag, uint16_t timestamp, int64_t nowUs) {
+        clearProducerStatsIfRequested();
+        int64_t remoteUs = unwrap(timestamp & TIMESTAMP_MASK, nowUs) * 1000;
+        int64_t offsetUs = nowUs - remoteUs;
+
+        if (resyncRequested) {
+            minOffsetUs = offsetUs;
+            resyncRequested = false;
+        } else {
+            // Creep ~100 ppm so a slower sender clock is followed too
+            minOffsetUs += (nowUs - lastArrivalUs) / DRIFT_DIVIDER;
+            if (offsetUs < minOffsetUs) {
+                minOffsetUs = offsetUs;
+            }
+        }
+        lastArrivalUs = nowUs;
+
+        int64_t dueUs = remoteUs + minOffsetUs + (int64_t)latencyMs * 1000;
+        if (dueUs < nowUs) {
+            underruns++;
+            dueUs = nowUs;
+        }
+
+        return enqueue({dueUs, param, value, tag});
+    }
+
+    /**
+     * @brief Queue an event for release at the next pop() (producer side)
+     *
+     * Keeps a change behind older buffered ones while they drain.
+     */
+    bool pushNow(uint8_t param, uint8_t value, uint8_t tag, int64_t nowUs) {
+        clearProducerStatsIfRequested();
+        return enqueue({nowUs, param, value, tag});
+    }
+
+    /**
+     * @brief Take a value held on overrun, once the ring is empty (consumer side)
+     *
+     * Everything queued before it has been released by then, so the held
+     * value is applied last, as the newest.
+     */
+    bool popHeld(Event& out) {
+        if (depth() != 0) {
+            return false;
+        }
+        for (uint8_t param = 0; param < MAX_PARAMS; param++) {
+            uint32_t held = this->held[param].exchange(0, std::memory_order_acquire);
+            if (held & HELD_VALID) {
+                out = {0, param, (uint8_t)held, (uint8_t)(held >> 8)};
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Take the next event that is due at nowUs (consumer side)
+     *
+     * With buffering disabled everything still queued is due, so it drains
+     * in order.
+     */
+    bool pop(int64_t nowUs, Event& out) {
+        if (playedResetRequested) {
+            played = 0;
+            playedResetRequested = false;
+        }
+        uint8_t tail = this->tail.load(std::memory_order_relaxed);
+        if (tail == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        if (latencyMs != 0 && events[tail].dueUs > nowUs) {
+            return false;
+        }
+        out = events[tail];
+        this->tail.store((tail + 1) % CAPACITY, std::memory_order_release);
+        played++;
+        return true;
+    }
+
+    uint8_t depth() const {
+        return (head.load(std::memory_order_acquire) + CAPACITY - tail.load(std::memory_order_acquire)) % CAPACITY;
+    }
+
+    bool hasHeld() const {
+        for (uint8_t param = 0; param < MAX_PARAMS; param++) {
+            if (held[param].load(std::memory_order_acquire) & HELD_VALID) return true;
+        }
+        return false;
+    }
+
+    Stats getStats() const {
+        return {queued, played, underruns, overruns, resyncs, maxDepth};
+    }
+
+    // Counters are cleared by the side that counts them: the producer's at
+    // the next push, played at the next pop
+    void resetStats() {
+        producerResetRequested = true;
+        playedResetRequested = true;
+    }
+
+private:
+    static constexpr uint16_t TIMESTAMP_MASK = 0x1FFF;  // 13-bit BLE-MIDI timestamp
+    static constexpr int64_t DRIFT_DIVIDER = 10000;     // 100 ppm
+    // Longer silences make the 8.192 s timestamp wrap ambiguous
+    static constexpr int64_t RESYNC_GAP_US = 4000000;
+    static constexpr uint32_t HELD_VALID = 0x10000;
+
+    Event events[CAPACITY];
+    std::atomic<uint8_t> head{0};
+    std::atomic<uint8_t> tail{0};
+    std::atomic<uint32_t> held[MAX_PARAMS] = {};  // Value | tag << 8 | HELD_VALID, newest dropped per param
+
+    volatile uint16_t latencyMs = 0;
+    volatile bool resyncRequested = true;
+    int64_t minOffsetUs = 0;
+    int64_t lastArrivalUs = 0;
+    int64_t remoteMs = 0;          // Unwrapped sender clock
+    uint16_t lastTimestamp = 0;
+
+    volatile uint32_t queued = 0;
+    volatile uint32_t played = 0;
+    volatile uint32_t underruns = 0;
+    volatile uint32_t overruns = 0;
+    volatile uint32_t resyncs = 0;
+    volatile uint8_t maxDepth = 0;
+    volatile bool producerResetRequested = false;
+    volatile bool playedResetRequested = false;
+
+    void clearProducerStatsIfRequested() {
+        if (producerResetRequested) {
+            queued = underruns = overruns = resyncs = 0;
+            maxDepth = 0;
+            producerResetRequested = false;
+        }
+    }
+
+    bool enqueue(const Event& event) {
+        uint8_t head = this->head.load(std::memory_order_relaxed);
+        uint8_t next = (head + 1) % CAPACITY;
+        uint8_t tail = this->tail.load(std::memory_order_acquire);
+        // While a value is held, newer ones of its param replace it rather
+        // than being queued ahead of it
+        bool holding = event.param < MAX_PARAMS &&
+                       (held[event.param].load(std::memory_order_relaxed) & HELD_VALID);
+        if (next == tail || holding) {
+            overruns++;
+            if (event.param < MAX_PARAMS) {
+                held[event.param].store(HELD_VALID | event.tag << 8 | event.value, std::memory_order_release);
+            }
+            return false;
+        }
+        events[head] = event;
+        this->head.store(next, std::memory_order_release);
+
+        queued++;
+        uint8_t depth = (next + CAPACITY - tail) % CAPACITY;
+        if (depth > maxDepth) maxDepth = depth;
+        return true;
+    }
+
+    // Extend the 13-bit timestamp to a monotonic millisecond count
+    int64_t unwrap(uint16_t timestamp, int64_t nowUs) {
+        if (!resyncRequested && nowUs - lastArrivalUs > RESYNC_GAP_US) {
+            resyncRequested = true;
+        }
+        if (resyncRequested) {
+            resyncs++;
+            remoteMs = timestamp;
+        } else {
+            remoteMs += (timestamp - lastTimestamp) & TIMESTAMP_MASK;
+        }
+        lastTimestamp = timestamp;
+        return remoteMs;
+    }
+};
@@ -1,11 +1,12 @@
 #pragma once
 #include <Arduino.h>
-#include <Wire.h>
 #include "LEDRingSmall.h"
+#include "ledframebuffer.h"
+#include "i2cbus.h"
 
 class LEDController {
 public:
-    LEDController() : ledRing(ISSI3746_SJ2 | ISSI3746_SJ7), currentEffect(0) {
+    LEDController() : ledRing(ISSI3746_SJ2 | ISSI3746_SJ7), frame(ledRing), currentEffect(0), lastConfigRefresh(0) {
         // Rainbow colors for each effect
         rainbowColors[0] = 0xFF0000; // Red - CONST_VIBE
         rainbowColors[1] = 0xFF8000; // Orange - PULSE  
@@ -16,8 +17,7 @@ public:
     }
     
     void begin() {
-        Wire.begin();
-        Wire.setClock(400000);
+        i2cBus.begin();  // No-op if the bit already started the bus
         
         ledRing.LEDRingSmall_Reset();
         delay(20);
@@ -52,9 +52,9 @@ public:
                 }
                 
                 if (shouldLight) {
-                    ledRing.LEDRingSmall_Set_RGB(i, rainbowColors[effectIndex]);
+                    frame.setRGB(i, rainbowColors[effectIndex]);
                 } else {
-                    ledRing.LEDRingSmall_Set_RGB(i, 0x000000);
+                    frame.setRGB(i, 0x000000);
                 }
             }
         //}
@@ -80,10 +80,10 @@ public:
             
             if (positionFromStart <= numLEDs) {
                 // Light up LED with gradient color based on position from start
-                ledRing.LEDRingSmall_Set_RGB(i, calculateHeatGradientColor(positionFromStart));
+                frame.setRGB(i, calculateHeatGradientColor(positionFromStart));
             } else {
                 // Turn off LED
-                ledRing.LEDRingSmall_Set_RGB(i, 0x000000);
+                frame.setRGB(i, 0x000000);
             }
         }
     }
@@ -100,13 +100,11 @@ public:
      */
     void updateAirDisplay(uint8_t airLevel) {
         // Clear all LEDs first
-        for (uint8_t i = 0; i < 24; i++) {
-            ledRing.LEDRingSmall_Set_RGB(i, 0x000000);
-        }
+        frame.clear();
         
         if (airLevel == 64) {
             // Center position - light only LED 0 with white
-            ledRing.LEDRingSmall_Set_RGB(0, 0xFFFFFF);
+            frame.setRGB(0, 0xFFFFFF);
             
         } else if (airLevel > 64) {
             // Inflation mode (65-127) - counterclockwise from center
@@ -114,13 +112,13 @@ public:
             uint8_t numLEDs = (inflationLevel * 12) / 63; // Map to 0-12 LEDs
             
             // Always light center LED
-            ledRing.LEDRingSmall_Set_RGB(0, 0xFFFFFF);
+            frame.setRGB(0, 0xFFFFFF);
             
             // Light inflation LEDs (23-13 counterclockwise)
             for (uint8_t i = 1; i <= numLEDs; i++) {
                 uint8_t ledIndex = (24 - i) % 24; // LED 23, 22, 21, ..., 13
                 // Red color for inflation
-                ledRing.LEDRingSmall_Set_RGB(ledIndex, 0xFF0000);
+                frame.setRGB(ledIndex, 0xFF0000);
             }
             
         } else {
@@ -129,25 +127,46 @@ public:
             uint8_t numLEDs = (deflationLevel * 12) / 63; // Map to 0-12 LEDs
             
             // Always light center LED
-            ledRing.LEDRingSmall_Set_RGB(0, 0xFFFFFF);
+            frame.setRGB(0, 0xFFFFFF);
             
             // Light deflation LEDs (1-12 clockwise)
             for (uint8_t i = 1; i <= numLEDs; i++) {
                 // Blue color for deflation
-                ledRing.LEDRingSmall_Set_RGB(i, 0x0000FF);
+                frame.setRGB(i, 0x0000FF);
             }
         }
     }
     
+    /**
+     * @brief Send what changed in the frame since the last refresh
+     * 
+     * Once a second the register cache is dropped, the global current and
+     * page are written again and the whole frame is resent, in case the
+     * chip lost its state.
+     */
     void refresh() {
-        ledRing.LEDRingSmall_GlobalCurrent(0x10);
-        ledRing.LEDRingSmall_PWM_MODE();
+        if (millis() - lastConfigRefresh >= CONFIG_REFRESH_MS) {
+            lastConfigRefresh = millis();
+            ledRing.LEDRingSmall_InvalidateShadow();
+            ledRing.LEDRingSmall_GlobalCurrent(0x10);
+            ledRing.LEDRingSmall_PWM_MODE();
+            frame.invalidate();
+        }
+        frame.flush();
+    }
+
+    void printRegisterStats(Stream& out) const {
+        ledRing.LEDRingSmall_Shadow().printStats(out, "LED ring (IS31FL3746A)");
     }
 
 private:
+    static constexpr unsigned long CONFIG_REFRESH_MS = 1000;
+
     LEDRingSmall ledRing;
+    LEDFramebuffer frame;
     uint32_t rainbowColors[6];
     int currentEffect;
+    unsigned long lastConfigRefresh;
     
     /**
      * @brief Calculate gradient color for heat display
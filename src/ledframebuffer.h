@@ -0,0 +1,93 @@
+#pragma once
+#include <Arduino.h>
+#include "LEDRingSmall.h"
+
+/**
+ * @brief RAM framebuffer for the LED ring with diffing burst flush
+ *
+ * Drawing only touches RAM. flush() compares the frame with the last one
+ * sent and writes only the PWM registers that changed, grouping nearby
+ * changes into auto-increment bursts. A static display costs no bus
+ * traffic at all.
+ *
+ * The IS31FL3746A PWM registers 0x01-0x48 hold the 24 RGB LEDs, so the
+ * frame is stored in register order and spans map directly to bursts.
+ */
+class LEDFramebuffer {
+public:
+    static constexpr uint8_t NUM_LEDS = 24;
+    static constexpr uint8_t FIRST_REGISTER = 0x01;
+    static constexpr uint8_t NUM_REGISTERS = 72;
+    // Unchanged bytes worth resending rather than starting a new transfer
+    // (each transfer costs an address byte, a register byte, start and stop)
+    static constexpr uint8_t MAX_GAP = 3;
+
+    explicit LEDFramebuffer(LEDRingSmall& ringRef) : ring(ringRef) {
+        invalidate();
+    }
+
+    void setRGB(uint8_t led, uint32_t color) {
+        if (led >= NUM_LEDS) return;
+        frame[index(0, led)] = (color >> 16) & 0xFF;
+        frame[index(1, led)] = (color >> 8) & 0xFF;
+        frame[index(2, led)] = color & 0xFF;
+    }
+
+    void clear() {
+        memset(frame, 0, sizeof(frame));
+    }
+
+    /**
+     * @brief Resend the whole frame on the next flush
+     *
+     * Used after a chip reset, or periodically in case the chip lost state.
+     */
+    void invalidate() {
+        sentValid = false;
+    }
+
+    /**
+     * @brief Send the registers that changed since the last flush
+     *
+     * The ring must be in PWM mode (page 0).
+     */
+    void flush() {
+        uint8_t reg = 0;
+
+        while (reg < NUM_REGISTERS) {
+            if (sentValid && frame[reg] == sent[reg]) {
+                reg++;
+                continue;
+            }
+
+            // Extend the span over changes, bridging short unchanged gaps
+            uint8_t start = reg;
+            uint8_t end = reg + 1;
+            uint8_t gap = 0;
+            for (uint8_t r = end; r < NUM_REGISTERS && gap <= MAX_GAP; r++) {
+                if (!sentValid || frame[r] != sent[r]) {
+                    end = r + 1;
+                    gap = 0;
+                } else {
+                    gap++;
+                }
+            }
+
+            ring.LEDRingSmall_Set_PWM_Burst(FIRST_REGISTER + start, frame + start, end - start);
+            memcpy(sent + start, frame + start, end - start);
+            reg = end;
+        }
+
+        sentValid = true;
+    }
+
+private:
+    LEDRingSmall& ring;
+    uint8_t frame[NUM_REGISTERS] = {};
+    uint8_t sent[NUM_REGISTERS] = {};
+    bool sentValid = false;
+
+    uint8_t index(uint8_t color, uint8_t led) const {
+        return ring.LEDRingSmall_PWM_Register(color, led) - FIRST_REGISTER;
+    }
+};
@@ -1,9 +1,14 @@
 #include <Arduino.h>
 #include <Control_Surface.h>
-#include <Wire.h>
-#include <Adafruit_LPS28.h>
 #include "cli.h"
 #include "ledcontrol.h"
+#include "i2cbus.h"
+#include "trace.h"
+#include "pressuresampler.h"
+#include "controlloop.h"
+#include "safetycutoff.h"
+#include "envelopeplayer.h"
+#include "blemidipacker.h"
 
 // MIDI Interface
 BluetoothMIDI_Interface midibt;
@@ -29,17 +34,488 @@ CCAbsoluteEncoder airEncoder {
 // Encoder Reset Button - connected to D12 (GPIO 47)
 Button encoderResetButton {47};
 
-// LPS28 Pressure Sensor Setup - using Adafruit LPS28 library
-Adafruit_LPS28 lps28;  // LPS28 sensor object using Adafruit library
-unsigned long lastPressureRead = 0;
+// LPS28 Pressure Sensor Setup - FIFO drained in bursts by its own task
+const uint8_t LPS28_ADDRESS = 0x5C;
+const int8_t LPS28_INT_PIN = -1;       // GPIO wired to the LPS28 INT (overpressure guard), -1 = not wired (see pinout.txt)
+const uint16_t LPS28_ODR_HZ = 100;
+const uint8_t LPS28_WATERMARK = 4;     // Samples per burst: 40 ms at 100 Hz
+const uint8_t LPS28_REGULATION_WATERMARK = 1;  // While regulating: the pumps follow every sample
+PressureSampler pressureSampler {LPS28_ADDRESS};  // FIFO polled: INT belongs to the guard
 float currentPressure = 0.0;
 uint8_t pressureMidiValue = 0;
 
+// CC25 is sent when the pressure moves past the deadband from the last sent
+// value (and the MIDI value changed), or when the heartbeat expires
+float cc25DeadbandHPa = 2.0;           // ~0.3 CC steps
+unsigned long cc25HeartbeatMs = 1000;
+uint8_t lastSentPressureValue = 0xFF;  // None sent yet
+float lastSentPressureHPa = 0.0;
+unsigned long lastPressureSend = 0;
+uint32_t cc25Sent = 0;
+uint32_t cc25Suppressed = 0;
+
+// Pressure regulation: CC24 sets a target pillow pressure and a PID loop
+// drives the pumps and valves from the filtered LPS28 reading, once per
+// sample. Off = legacy mode, CC24 sets the pump speed directly.
+const float AIR_TARGET_MAX_HPA = 200.0;     // Target at CC24=127, above ambient
+const float AIR_KP = 0.15;                  // Command per hPa of error
+const float AIR_KI = 0.05;                  // Command per hPa-second of error
+const float AIR_KD = 0.005;                 // Command per hPa/s, on the measurement
+const float AIR_INTEGRAL_LIMIT = 0.3;       // Enough to hold against the leak
+const float AIR_OUTPUT_RATE_PER_S = 4.0;    // Full inflate to full deflate in 0.5 s
+const float AIR_TARGET_RATE_HPA_PER_S = 50.0;
+const float AIR_HOLD_BAND = 0.02;           // |command| below this closes both valves
+const uint8_t PUMP_MIN_PWM = 80;            // Pumps stall below this
+const float PRESSURE_FILTER_TAU_S = 0.03;
+const float MAX_AIR_DT_S = 0.1;
+bool pressureRegulation = false;
+bool airTargetActive = false;     // Set by CC24, cleared by the reset button
+bool airTracePending = false;
+float airTargetHPa = 0.0;
+float airRampedTargetHPa = 0.0;   // What the PID follows
+volatile float ambientHPa = 0.0;  // 0 = no reference yet (see startAmbientZero())
+float filteredGaugeHPa = 0.0;
+float airCommand = 0.0;           // -1 deflate .. 1 inflate
+uint32_t lastPressureSampleUs = 0;
+PIDController airController {AIR_KP, AIR_KI, AIR_KD};
+LowPassFilter pressureFilter {PRESSURE_FILTER_TAU_S};
+StepMetrics airStep;
+uint32_t airStepStartUs = 0;
+
+// Pressure guard: independent of the loop, MIDI and Serial. The LPS28
+// compares every sample against the overpressure level and raises INT,
+// whose ISR cuts off; a task reads the output register at twice the ODR
+// for both limits; a timer ISR cuts off if that task stops while a pump
+// runs. Cutoff stops the pumps, closes the inflate valve and opens the
+// deflate valve, and holds until `guard rearm`. The INT path needs
+// LPS28_INT_PIN wired; the limits relative to ambient need a reference
+// (`airpid on` or `airpid zero`), until then only ABSOLUTE_MAX_HPA guards.
+// Without an LPS28 at boot the guard is off and the bit runs open loop as
+// before: CC24 sets the pump speed and `airpid on` is refused.
+const float OVERPRESSURE_HPA = 250.0;   // Above ambient; regulation tops out at 200
+const float UNDERPRESSURE_HPA = -50.0;  // Deflate pump pulling a vacuum
+const float ABSOLUTE_MAX_HPA = 1350.0;  // Absolute, whatever the ambient reference says
+const uint32_t GUARD_POLL_MS = 5;
+const uint8_t GUARD_PRIORITY = 10;      // Above the loop and BLE host tasks
+const uint32_t GUARD_TIMEOUT_US = 50000;
+const uint32_t GUARD_WATCHDOG_PERIOD_US = 2000;
+enum CutoffReason : uint8_t {
+    CUTOFF_OVERPRESSURE_INT = 1,
+    CUTOFF_OVERPRESSURE,
+    CUTOFF_UNDERPRESSURE,
+    CUTOFF_SENSOR_STALE,
+    CUTOFF_INJECTED,
+    CUTOFF_ABSOLUTE_OVERPRESSURE,
+};
+SafetyCutoff airCutoff;
+hw_timer_t* guardTimer = nullptr;
+TaskHandle_t guardTask = nullptr;
+bool pressureSensorFitted = false;         // LPS28 answered at boot
+std::atomic<bool> pumpsRunning{false};
+std::atomic<uint32_t> lastGuardCheckUs{0};
+std::atomic<uint32_t> injectedFaultUs{0};   // `guard inject`: time of the fake fault
+volatile float guardPressureHPa = 0.0;      // Last reading of the guard task
+bool cutoffReported = false;
+
+// Ambient reference: the pillow can stay inflated across a reset (hold
+// closes both valves, so does a brownout), so ambient is taken with the
+// deflate valve open once the reading has settled, and only if it is a
+// plausible atmospheric pressure. Regulation needs it, so it is taken when
+// `airpid on` finds none, or on `airpid zero`; open loop does not vent.
+const float AMBIENT_MIN_HPA = 700.0;     // ~3000 m altitude
+const float AMBIENT_MAX_HPA = 1085.0;    // Highest sea-level pressure on record
+const float AMBIENT_SETTLE_HPA = 0.3;    // Change per window that counts as settled
+const uint32_t AMBIENT_SETTLE_MS = 1000;
+const uint32_t AMBIENT_TIMEOUT_MS = 15000;
+bool ambientZeroing = false;
+uint32_t ambientZeroStartMs = 0;
+uint32_t ambientWindowStartMs = 0;
+float ambientWindowHPa = 0.0;
+
+// Leak-compensating hold: once the PID has kept the pressure within the
+// band for HOLD_ENTRY_S, both valves close and LeakHold tops the pillow
+// up with timed pump pulses, learning the leak and pump rate as it goes
+const float HOLD_BAND_HPA = 2.0;
+const float HOLD_ENTRY_S = 2.0;
+const float HOLD_PULSE_COMMAND = 0.5;  // Moderate PWM: quieter than full, well above stall
+bool leakHoldEnabled = true;
+bool holding = false;
+bool holdEntryPending = false;
+uint32_t holdEntrySinceUs = 0;
+uint32_t holdStartUs = 0;
+LeakHold leakHold {HOLD_BAND_HPA, PRESSURE_FILTER_TAU_S + 0.02f};
+esp_timer_handle_t holdPulseTimer = nullptr;
+
 // Use default I2C pins (GPIO 21 = SDA, GPIO 22 = SCL)
 // These work fine alongside encoder and other I2C devices
 
 // Pressure Output - we'll send CC25 directly via MIDI interface
 
+const char* cutoffReasonName(uint8_t reason) {
+    switch (reason) {
+        case CUTOFF_OVERPRESSURE_INT: return "overpressure (LPS28 INT)";
+        case CUTOFF_OVERPRESSURE: return "overpressure";
+        case CUTOFF_UNDERPRESSURE: return "underpressure";
+        case CUTOFF_SENSOR_STALE: return "pressure guard stalled";
+        case CUTOFF_INJECTED: return "injected fault";
+        case CUTOFF_ABSOLUTE_OVERPRESSURE: return "overpressure (absolute)";
+        default: return "none";
+    }
+}
+
+/**
+ * @brief LPS28 threshold interrupt: the sensor saw overpressure
+ */
+void IRAM_ATTR overpressureISR() {
+    airCutoff.trip((uint32_t)esp_timer_get_time(), CUTOFF_OVERPRESSURE_INT);
+}
+
+/**
+ * @brief Software guard: both limits, straight from the output register
+ *
+ * Worst case from a crossing to the pins: one ODR period (10 ms) until
+ * the sample exists, one poll period (5 ms), and the read.
+ */
+void pressureGuardTask(void*) {
+    TickType_t lastWake = xTaskGetTickCount();
+    while (true) {
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(GUARD_POLL_MS));
+        float pressureHPa;
+        if (!pressureSampler.readPressureNow(pressureHPa)) {
+            continue;  // The watchdog cuts off if this persists
+        }
+        uint32_t now = (uint32_t)esp_timer_get_time();
+        lastGuardCheckUs.store(now);
+        guardPressureHPa = pressureHPa;
+
+        uint32_t injected = injectedFaultUs.exchange(0);
+        float ambient = ambientHPa;
+        if (injected != 0) {
+            // Measured from the injection, so it includes waiting for the poll
+            airCutoff.trip(injected, CUTOFF_INJECTED);
+        } else if (pressureHPa > ABSOLUTE_MAX_HPA) {
+            airCutoff.trip(now, CUTOFF_ABSOLUTE_OVERPRESSURE);
+        } else if (ambient == 0) {
+            continue;  // No reference yet
+        } else if (pressureHPa - ambient > OVERPRESSURE_HPA) {
+            airCutoff.trip(now, CUTOFF_OVERPRESSURE);
+        } else if (pressureHPa - ambient < UNDERPRESSURE_HPA) {
+            airCutoff.trip(now, CUTOFF_UNDERPRESSURE);
+        }
+    }
+}
+
+/**
+ * @brief Guard watchdog: a pump running with no pressure check is cut off
+ */
+void IRAM_ATTR guardWatchdogISR() {
+    if (!pressureSensorFitted || !pumpsRunning.load() || airCutoff.isTripped()) {
+        return;
+    }
+    uint32_t deadline = lastGuardCheckUs.load() + GUARD_TIMEOUT_US;
+    if ((int32_t)((uint32_t)esp_timer_get_time() - deadline) > 0) {
+        airCutoff.trip(deadline, CUTOFF_SENSOR_STALE);
+    }
+}
+
+/**
+ * @brief Program the LPS28 overpressure interrupt from the ambient reference
+ *
+ * Never above ABSOLUTE_MAX_HPA, which is also the level until ambient is known.
+ */
+void setOverpressureThreshold() {
+    if (LPS28_INT_PIN < 0) {
+        return;  // Nothing listens to INT
+    }
+    float ambient = ambientHPa;
+    float limit = ambient > 0 ? min(ambient + OVERPRESSURE_HPA, ABSOLUTE_MAX_HPA) : ABSOLUTE_MAX_HPA;
+    if (!pressureSampler.setHighThreshold(limit)) {
+        Serial.println("Pressure guard: could not set the LPS28 threshold, software guard only");
+    }
+}
+
+/**
+ * @brief Drive pumps and valves from a signed regulator command
+ *
+ * The magnitude is mapped above PUMP_MIN_PWM so any command outside the
+ * hold band actually moves air.
+ */
+void driveAir(float command) {
+    airCommand = command;
+    pumpsRunning = fabs(command) > AIR_HOLD_BAND;
+    uint8_t pwmValue = PUMP_MIN_PWM + fabs(command) * (255 - PUMP_MIN_PWM);
+    if (command > AIR_HOLD_BAND) {
+        ledcWrite(PWM_CHANNELS[0], pwmValue);  // M1 pump inflate
+        ledcWrite(PWM_CHANNELS[1], 0);
+        ledcWrite(PWM_CHANNELS[2], 255);       // M3 valve inflate
+        ledcWrite(PWM_CHANNELS[3], 0);
+    } else if (command < -AIR_HOLD_BAND) {
+        ledcWrite(PWM_CHANNELS[0], 0);
+        ledcWrite(PWM_CHANNELS[1], pwmValue);  // M2 pump deflate
+        ledcWrite(PWM_CHANNELS[2], 0);
+        ledcWrite(PWM_CHANNELS[3], 255);       // M4 valve deflate
+    } else {
+        for (int i = 0; i < 4; i++) {
+            ledcWrite(PWM_CHANNELS[i], 0);     // Hold: valves closed
+        }
+    }
+}
+
+// Runs in the esp_timer task: ends a hold pulse on time, not at the next burst
+void endHoldPulse(void*) {
+    driveAir(0);
+}
+
+void exitHold() {
+    holding = false;
+    holdEntryPending = false;
+    if (holdPulseTimer != nullptr) {
+        esp_timer_stop(holdPulseTimer);
+    }
+}
+
+/**
+ * @brief Hold step on a filtered sample: pulse when LeakHold asks for one
+ */
+void runHold(float gaugeHPa, uint32_t timeUs) {
+    float timeS = (timeUs - holdStartUs) * 1e-6f;
+    float pulseS = leakHold.update(timeS, gaugeHPa);
+    if (leakHold.isLost()) {
+        exitHold();
+        airController.reset(0);
+        Serial.print("Hold: left the band at ");
+        Serial.print(gaugeHPa, 1);
+        Serial.println(" hPa, regulating");
+        return;
+    }
+    if (pulseS <= 0) {
+        return;
+    }
+    driveAir(HOLD_PULSE_COMMAND);
+    esp_timer_start_once(holdPulseTimer, (uint64_t)(pulseS * 1e6f));
+    Serial.print("Hold: pulse ");
+    Serial.print(pulseS * 1000, 0);
+    Serial.print(" ms, leak ");
+    Serial.print(leakHold.getLeakHPaPerS(airTargetHPa), 3);
+    Serial.print(" hPa/s, pump duty ");
+    Serial.print(leakHold.getDutyCycle(timeS) * 100, 2);
+    Serial.println("%");
+}
+
+// Stored air envelopes, played on the pumps and valves by their own task
+// (Program Change 1..N or `envelope <n>`; 0, CC24, the reset button or
+// `envelope stop` ends them). Amplitude 128 = hold (valves closed), above
+// inflates and below deflates like a regulator command; step times in ms.
+constexpr HapticStep AIR_BREATHE_STEPS[] = {{200, 3000}, {128, 1000}, {56, 3000}, {128, 1000}};
+constexpr HapticStep AIR_SLOW_BREATHE_STEPS[] = {
+    {170, 2000}, {200, 2000}, {170, 2000}, {128, 1500},
+    {86, 2000}, {56, 2000}, {86, 2000}, {128, 1500}
+};
+constexpr HapticStep AIR_INFLATE_STEPS[] = {{230, 500}, {128, 1500}};
+constexpr HapticEffect AIR_BREATHE = makeEffect(AIR_BREATHE_STEPS);
+constexpr HapticEffect AIR_SLOW_BREATHE = makeEffect(AIR_SLOW_BREATHE_STEPS);
+constexpr HapticEffect AIR_INFLATE = makeEffect(AIR_INFLATE_STEPS);
+const HapticEffect* const AIR_ENVELOPES[] = {&AIR_BREATHE, &AIR_SLOW_BREATHE, &AIR_INFLATE};
+const uint8_t NUM_AIR_ENVELOPES = sizeof(AIR_ENVELOPES) / sizeof(AIR_ENVELOPES[0]);
+
+// Runs on the envelope task
+void airEnvelopeOutput(uint8_t amplitude, void*) {
+    driveAir(((int)amplitude - 128) / 127.0f);
+}
+EnvelopePlayer airEnvelope {airEnvelopeOutput, nullptr, 128};
+
+/**
+ * @brief Start a stored envelope (1..NUM_AIR_ENVELOPES), 0 stops
+ *
+ * The envelope owns the pumps and valves while it plays; a target
+ * pressure needs a new CC24 after it.
+ */
+bool playAirEnvelope(uint8_t number, bool loop) {
+    if (number == 0) {
+        if (airEnvelope.isPlaying()) {
+            airEnvelope.stop();
+        }
+        return true;
+    }
+    if (airCutoff.isTripped() || number > NUM_AIR_ENVELOPES) {
+        return false;
+    }
+    exitHold();
+    airTargetActive = false;
+    airController.reset(0);
+    airEnvelope.play(AIR_ENVELOPES[number - 1], loop);
+    Serial.print("Air envelope ");
+    Serial.print(number);
+    Serial.println(loop ? " (looping)" : "");
+    return true;
+}
+
+/**
+ * @brief Set the target pressure; the PID loop follows from the next sample
+ */
+void setAirTarget(float hPa) {
+    if (!airTargetActive) {
+        // Start the ramp from where the pillow is
+        airRampedTargetHPa = filteredGaugeHPa;
+        airController.reset(0);
+    }
+    if (holding) {
+        exitHold();
+        airController.reset(0);
+    }
+    airTargetHPa = hPa;
+    airTargetActive = true;
+    airTracePending = true;
+    airStepStartUs = lastPressureSampleUs;
+    airStep.begin(0, filteredGaugeHPa, hPa);
+}
+
+/**
+ * @brief Stop regulating and close everything
+ */
+void stopAirRegulation() {
+    playAirEnvelope(0, false);
+    exitHold();
+    airTargetActive = false;
+    airController.reset(0);
+    driveAir(0);
+}
+
+/**
+ * @brief Vent the pillow and take a new ambient reference once it settles
+ *
+ * CC24 is ignored meanwhile; the absolute limit still guards.
+ */
+void startAmbientZero() {
+    stopAirRegulation();
+    ambientHPa = 0;
+    setOverpressureThreshold();
+    for (int i = 0; i < 3; i++) {
+        ledcWrite(PWM_CHANNELS[i], 0);
+    }
+    ledcWrite(PWM_CHANNELS[3], 255);  // M4 valve deflate open
+    ambientZeroing = true;
+    ambientZeroStartMs = millis();
+    ambientWindowStartMs = ambientZeroStartMs;
+    ambientWindowHPa = 0;  // First window never counts as settled
+    Serial.println("Venting to take the ambient pressure reference...");
+}
+
+/**
+ * @brief Feed a sample to the ambient capture, finish when settled or timed out
+ */
+void updateAmbientZero(float pressureHPa) {
+    uint32_t now = millis();
+    if (now - ambientWindowStartMs < AMBIENT_SETTLE_MS) {
+        return;
+    }
+    bool settled = fabs(pressureHPa - ambientWindowHPa) < AMBIENT_SETTLE_HPA;
+    ambientWindowStartMs = now;
+    ambientWindowHPa = pressureHPa;
+    if (!settled && now - ambientZeroStartMs < AMBIENT_TIMEOUT_MS) {
+        return;
+    }
+
+    ledcWrite(PWM_CHANNELS[3], 0);
+    ambientZeroing = false;
+    if (settled && pressureHPa >= AMBIENT_MIN_HPA && pressureHPa <= AMBIENT_MAX_HPA) {
+        ambientHPa = pressureHPa;
+        pressureFilter.reset();
+        setOverpressureThreshold();
+        Serial.print("Ambient pressure: ");
+        Serial.print(pressureHPa, 1);
+        Serial.println(" hPa");
+    } else {
+        Serial.print("Ambient reference rejected (");
+        Serial.print(pressureHPa, 1);
+        Serial.print(settled ? " hPa, outside " : " hPa, not settled; plausible ");
+        Serial.print(AMBIENT_MIN_HPA, 0);
+        Serial.print("-");
+        Serial.print(AMBIENT_MAX_HPA, 0);
+        Serial.println(" hPa): absolute limit only, regulation off until 'airpid zero'");
+    }
+}
+
+/**
+ * @brief One PID step on a filtered pressure sample
+ */
+void regulateAir(float gaugeHPa, uint32_t timeUs, float dtS) {
+    if (airStep.isActive()) {
+        airStep.add((timeUs - airStepStartUs) * 1e-6f, gaugeHPa);
+    }
+    if (!airTargetActive) {
+        return;
+    }
+    if (holding) {
+        runHold(gaugeHPa, timeUs);
+        return;
+    }
+    // Ramp the setpoint so a big CC24 jump does not slam the pumps
+    float maxStep = AIR_TARGET_RATE_HPA_PER_S * dtS;
+    airRampedTargetHPa += constrain(airTargetHPa - airRampedTargetHPa, -maxStep, maxStep);
+    driveAir(airController.update(airRampedTargetHPa, gaugeHPa, dtS));
+    if (airTracePending) {
+        tracer.stamp(TracePath::CC24Air, TraceStage::Actuator);
+        airTracePending = false;
+    }
+    
+    // Hand over to the hold once the target has been kept for a while
+    bool inBand = fabs(airTargetHPa - airRampedTargetHPa) < 0.01f &&
+                  fabs(gaugeHPa - airTargetHPa) < HOLD_BAND_HPA;
+    if (!leakHoldEnabled || !inBand || airTargetHPa <= 0) {
+        holdEntryPending = false;
+    } else if (!holdEntryPending) {
+        holdEntryPending = true;
+        holdEntrySinceUs = timeUs;
+    } else if (timeUs - holdEntrySinceUs >= HOLD_ENTRY_S * 1e6f) {
+        holding = true;
+        holdStartUs = timeUs;
+        leakHold.begin(0, airTargetHPa);
+        driveAir(0);
+        Serial.println("Hold: valves closed, topping up with pulses");
+    }
+}
+
+/**
+ * @brief Switch between pressure regulation and direct pump control
+ */
+bool setPressureRegulation(bool on) {
+    if (on && !pressureSensorFitted) {
+        return false;
+    }
+    if (on == pressureRegulation) {
+        return true;
+    }
+    pressureRegulation = on;
+    // Samples one by one while regulating, so the PID output reaches the
+    // pumps at the rate it is computed (and simulated by 'airpid sim')
+    pressureSampler.setWatermark(on ? LPS28_REGULATION_WATERMARK : LPS28_WATERMARK);
+    if (on && ambientHPa == 0 && !ambientZeroing) {
+        startAmbientZero();  // Also stops
+    } else {
+        stopAirRegulation();  // Wait for the next CC24 either way
+    }
+    return true;
+}
+
+void printStepMetrics(Stream& out, const StepMetrics::Result& r) {
+    out.print("  Step ");
+    out.print(r.from, 1);
+    out.print(" -> ");
+    out.print(r.target, 1);
+    out.print(" hPa: rise ");
+    if (r.riseTimeS < 0) out.print("-"); else out.print(r.riseTimeS * 1000, 0);
+    out.print(" ms, settling ");
+    if (r.settlingTimeS < 0) out.print("-"); else out.print(r.settlingTimeS * 1000, 0);
+    out.print(" ms, overshoot ");
+    out.print(r.overshootPct, 1);
+    out.print("%, steady-state error ");
+    out.print(r.steadyStateError, 2);
+    out.print(" hPa (");
+    out.print(r.samples);
+    out.println(" samples)");
+}
+
 /**
  * @brief Custom MIDI sink for air/pump control
  * 
@@ -54,18 +530,48 @@ public:
     AirControlSink() {}
     
     void sinkMIDIfromPipe(ChannelMessage msg) override {
+        if (msg.getMessageType() == MIDIMessageType::ProgramChange) {
+            playAirEnvelope(msg.getData1(), true);
+            return;
+        }
         // Handle CC 24 messages for air control
         if (msg.getMessageType() == MIDIMessageType::ControlChange && 
             msg.getData1() == 24) {
+            tracer.stamp(TracePath::CC24Air, TraceStage::Sink);
             
             uint8_t ccValue = msg.getData2();
+            if (airCutoff.isTripped()) {
+                Serial.println("Air cut off by the pressure guard, 'guard rearm' to restore");
+                return;
+            }
+            if (ambientZeroing) {
+                Serial.println("Taking the ambient reference, CC24 ignored");
+                return;
+            }
             currentAirLevel = ccValue;
+            if (airEnvelope.isPlaying()) {
+                // Live control takes over: no rest output to race the writes below
+                airEnvelope.release();
+            }
+            
+            if (pressureRegulation) {
+                // CC24 is a target pressure, full scale = AIR_TARGET_MAX_HPA
+                setAirTarget(ccValue * AIR_TARGET_MAX_HPA / 127);
+                Serial.print("Air target: ");
+                Serial.print(airTargetHPa, 1);
+                Serial.print(" hPa (CC24=");
+                Serial.print(ccValue);
+                Serial.println(")");
+                return;
+            }
             
             if (ccValue <= 66 && ccValue >= 62) {
                 // Stop - all motors off
                 for (int i = 0; i < 4; i++) {
                     ledcWrite(PWM_CHANNELS[i], 0);
                 }
+                pumpsRunning = false;
+                tracer.stamp(TracePath::CC24Air, TraceStage::Actuator);
                 Serial.println("Air control: STOPPED (CC24=64)");
                 
             } else if (ccValue > 66) {
@@ -79,6 +585,8 @@ public:
                 // M3 valve inflate (ON), M4 valve deflate (OFF)
                 ledcWrite(PWM_CHANNELS[2], 255);  // M3 (GPIO 10)
                 ledcWrite(PWM_CHANNELS[3], 0);         // M4 (GPIO 9)
+                pumpsRunning = pwmValue > 0;
+                tracer.stamp(TracePath::CC24Air, TraceStage::Actuator);
                 
                 Serial.print("Air control: INFLATING ");
                 Serial.print(((ccValue - 64) * 100) / 63);
@@ -99,6 +607,8 @@ public:
                 // M3 valve inflate (OFF), M4 valve deflate (ON)
                 ledcWrite(PWM_CHANNELS[2], 0);         // M3 (GPIO 10)
                 ledcWrite(PWM_CHANNELS[3], 255);  // M4 (GPIO 9)
+                pumpsRunning = pwmValue > 0;
+                tracer.stamp(TracePath::CC24Air, TraceStage::Actuator);
                 
                 Serial.print("Air control: DEFLATING ");
                 Serial.print(((63 - ccValue) * 100) / 63);
@@ -142,44 +652,64 @@ AirControlSink airSink;
  *  └─────────────────┘    └──────────────┘
  */
 
-// Pipe factory for proper routing management (need 2 pipes for separation of concerns)
-MIDI_PipeFactory<3> pipeFactory;
+// Transmit packer: one BLE-MIDI packet per connection interval (Route 1; the air routes use tracing pipes)
+BLEMIDIPacker blePacker {midibt};
+
+// CC24 latency stamps as messages enter the air routes (CLI `trace`)
+TracingPipe bleTracePipe {24, TracePath::CC24Air, TraceStage::Input};
+TracingPipe encoderTracePipe {24, TracePath::CC24Air, TraceStage::Input};
 
 /**
- * @brief Update pressure reading and send CC25 MIDI message
+ * @brief Take new pressure samples and send CC25 if it moved
  * 
- * Uses status-based reading following official Adafruit patterns.
- * Only reads when data is ready, more efficient than timer-based polling.
- * Initial mapping: 950-1050 hPa → 0-127 MIDI range (adjustable based on actual readings)
+ * Drains the samples the LPS28 task published since the last call and
+ * reports the newest. Within the deadband only the heartbeat is sent.
+ * Mapping: 880-1750 hPa → 0-127 MIDI range
  */
 void updatePressureReading() {
-    // Check if pressure data is ready using official Adafruit pattern
-    if (lps28.getStatus() & LPS28_STATUS_PRESS_READY) {
-        // Read pressure and temperature directly using official methods
-        float pressureHPa = lps28.getPressure();
-        float temperatureC = lps28.getTemperature();
-        currentPressure = pressureHPa;
-        
-        // Map pressure to MIDI range (measured range: 880-1250 hPa)
-        // Constrain to prevent wraparound below minimum pressure
-        long pressureCentiPa = (long)(pressureHPa * 100);
-        pressureMidiValue = map(pressureCentiPa, 88000, 175000, 0, 127);
-        pressureMidiValue = constrain(pressureMidiValue, 0, 127);
-        
-        // Send CC25 MIDI message directly
-        midibt.sendControlChange({25, Channel_1}, pressureMidiValue);
-        
-        // Throttle serial output to avoid flooding (only every 100ms)
-        if (millis() - lastPressureRead >= 100) {
-            Serial.print("Pressure: ");
-            Serial.print(currentPressure, 2);
-            Serial.print(" hPa, Temp: ");
-            Serial.print(temperatureC, 1);
-            Serial.print(" °C, MIDI CC25: ");
-            Serial.println(pressureMidiValue);
-            lastPressureRead = millis();
+    PressureSample sample;
+    bool fresh = false;
+    while (pressureSampler.pop(sample)) {
+        fresh = true;
+        if (ambientZeroing) {
+            updateAmbientZero(sample.pressureHPa);
+        }
+        if (ambientHPa == 0) {
+            lastPressureSampleUs = sample.timeUs;
+            continue;  // Gauge pressure is meaningless without a reference
+        }
+        float dtS = (sample.timeUs - lastPressureSampleUs) * 1e-6f;
+        lastPressureSampleUs = sample.timeUs;
+        if (dtS > MAX_AIR_DT_S) {
+            dtS = MAX_AIR_DT_S;
+        }
+        filteredGaugeHPa = pressureFilter.update(sample.pressureHPa - ambientHPa, dtS);
+        if (pressureRegulation && !airEnvelope.isPlaying()) {
+            regulateAir(filteredGaugeHPa, sample.timeUs, dtS);
         }
     }
+    if (!fresh) {
+        return;
+    }
+    currentPressure = sample.pressureHPa;
+    
+    // Map pressure to MIDI range: 880-1750 hPa → 0-127
+    // Constrain to prevent wraparound below minimum pressure
+    long pressureCentiPa = (long)(currentPressure * 100);
+    pressureMidiValue = constrain(map(pressureCentiPa, 88000, 175000, 0, 127), 0, 127);
+    
+    unsigned long now = millis();
+    bool moved = pressureMidiValue != lastSentPressureValue &&
+                 fabs(currentPressure - lastSentPressureHPa) >= cc25DeadbandHPa;
+    if (!moved && lastSentPressureValue != 0xFF && now - lastPressureSend < cc25HeartbeatMs) {
+        cc25Suppressed++;
+        return;
+    }
+    blePacker.sendControlChange({25, Channel_1}, pressureMidiValue);
+    lastSentPressureValue = pressureMidiValue;
+    lastSentPressureHPa = currentPressure;
+    lastPressureSend = now;
+    cc25Sent++;
 }
 
 void setup() {
@@ -194,18 +724,22 @@ void setup() {
         ledcWrite(PWM_CHANNELS[i], 0); // Start with all motors off
     }
     Serial.println("PWM channels initialized for pump/valve control");
+    // Cutoff: pumps and inflate valve off, deflate valve open
+    airCutoff.addPin(MOTOR_PINS[0], PWM_CHANNELS[0], LOW);
+    airCutoff.addPin(MOTOR_PINS[1], PWM_CHANNELS[1], LOW);
+    airCutoff.addPin(MOTOR_PINS[2], PWM_CHANNELS[2], LOW);
+    airCutoff.addPin(MOTOR_PINS[3], PWM_CHANNELS[3], HIGH);
     
     // Initialize I2C for LPS28 pressure sensor (default pins work fine with encoder)
     Serial.println("Initializing I2C for LPS28 pressure sensor...");
-    Wire.begin();  // Use default I2C pins (GPIO 21 = SDA, GPIO 22 = SCL)
+    i2cBus.begin();  // Use default I2C pins (GPIO 21 = SDA, GPIO 22 = SCL)
     
     // I2C device scanning with delay as requested
     Serial.println("Scanning I2C devices...");
     //delay(5000);  // 5 second delay so user doesn't miss I2C device detection messages
     int deviceCount = 0;
     for (byte address = 1; address < 127; address++) {
-        Wire.beginTransmission(address);
-        if (Wire.endTransmission() == 0) {
+        if (i2cBus.probe(address)) {
             Serial.print("I2C device found at address 0x");
             if (address < 16) Serial.print("0");
             Serial.println(address, HEX);
@@ -220,40 +754,68 @@ void setup() {
         Serial.println(" I2C device(s)");
     }
     
-    // Try to initialize LPS28 with the detected I2C address 0x5C  
-    if (!lps28.begin(&Wire, 0x5C)) {
+    // LPS28: FIFO in stream mode, drained on the watermark interrupt
+    if (!pressureSampler.begin(LPS28_ODR_HZ, LPS28_WATERMARK)) {
         Serial.println("Failed to initialize LPS28 chip at address 0x5C");
         Serial.println("Continuing without pressure sensor...");
+        Serial.println("Pressure guard off: open loop only, CC24 sets the pump speed");
         // Don't halt - continue without pressure sensor
     } else {
         Serial.println("LPS28 Found and initialized at address 0x5C!");
         
-        // Configure sensor for optimal accuracy and stability
-        lps28.setDataRate(LPS28_ODR_10_HZ);
-        lps28.setAveraging(LPS28_AVG_4);        // 4-sample averaging for noise reduction
-        lps28.setFullScaleMode(true);           // Extended range (4060 hPa) for better resolution
-        
         Serial.println("LPS28 pressure sensor configured:");
-        Serial.println("  - Data rate: 10 Hz");
-        Serial.println("  - Averaging: 4 samples (noise reduction)");
+        Serial.print("  - Data rate: ");
+        Serial.print(LPS28_ODR_HZ);
+        Serial.println(" Hz, 16 samples averaged");
+        Serial.print("  - FIFO watermark: ");
+        Serial.print(LPS28_WATERMARK);
+        Serial.println(pressureSampler.usesInterrupt() ? " samples, INT on GPIO 5" : " samples, polled");
         Serial.println("  - Full-scale mode: Extended range (4060 hPa)");
         Serial.println("LPS28 pressure sensor ready!");
+        pressureSensorFitted = true;
+        setOverpressureThreshold();
     }
     
+    // Pressure guard: LPS28 INT (if wired), guard task, watchdog timer (1 MHz)
+    if (LPS28_INT_PIN >= 0) {
+        // Held low, so an unconnected or floating line cannot trip the cutoff
+        pinMode(LPS28_INT_PIN, INPUT_PULLDOWN);
+        attachInterrupt(digitalPinToInterrupt(LPS28_INT_PIN), overpressureISR, RISING);
+    }
+    xTaskCreatePinnedToCore(pressureGuardTask, "PressureGuard", 3072, nullptr, GUARD_PRIORITY, &guardTask, 0);
+    guardTimer = timerBegin(1, 80, true);
+    timerAttachInterrupt(guardTimer, &guardWatchdogISR, true);
+    timerAlarmWrite(guardTimer, GUARD_WATCHDOG_PERIOD_US, true);
+    timerAlarmEnable(guardTimer);
+    
+    if (!airEnvelope.begin()) {
+        Serial.println("Air envelopes unavailable: no step timer");
+    }
+    
+    // Pressure regulator limits (off until 'airpid on')
+    airController.setIntegralLimit(AIR_INTEGRAL_LIMIT);
+    airController.setOutputRateLimit(AIR_OUTPUT_RATE_PER_S);
+    esp_timer_create_args_t pulseTimerArgs = {};
+    pulseTimerArgs.callback = &endHoldPulse;
+    pulseTimerArgs.dispatch_method = ESP_TIMER_TASK;
+    pulseTimerArgs.name = "air_hold_pulse";
+    esp_timer_create(&pulseTimerArgs, &holdPulseTimer);
+    
     // Set up clean pipe-based routing BEFORE Control_Surface.begin()
     // Three explicit, unidirectional routes for clear separation of concerns:
     
     // Route 1: Control_Surface (Air Encoder) → Bluetooth (CC23 transmission)
-    Control_Surface >> pipeFactory >> midibt;
+    Control_Surface >> blePacker >> midibt;
     
     // Route 2: Bluetooth → AirSink (external MIDI control of air)
-    midibt >> pipeFactory >> airSink;
+    midibt >> bleTracePipe >> airSink;
     
     // Route 3: Control_Surface → AirSink (direct encoder control)
-    Control_Surface >> pipeFactory >> airSink;
+    Control_Surface >> encoderTracePipe >> airSink;
     
     // Set Bluetooth device name
     midibt.setName("AIR bit 1 MST");
+    blePacker.begin();
     
     // Initialize LED controller
     ledController.begin();
@@ -268,33 +830,296 @@ void setup() {
             
     // Initialize CLI
     commandInterface.begin();
+    commandInterface.addCommand("blemidi", "Bluetooth MIDI packing: packets/s, messages per packet, queueing ('blemidi interval <ms>|reset')",
+        [](Stream& out, const String& args) {
+            if (args.startsWith("interval")) {
+                long ms = args.substring(8).toInt();
+                if (ms > 0) {
+                    blePacker.setInterval(ms);
+                }
+            } else if (args == "reset") {
+                blePacker.resetStats();
+                out.println("BLE MIDI stats cleared");
+                return;
+            }
+            blePacker.printStats(out);
+        });
+    commandInterface.addCommand("regs", "Register cache hits: writes issued vs suppressed",
+        [](Stream& out, const String&) {
+            ledController.printRegisterStats(out);
+        });
+    commandInterface.addCommand("i2c", "I2C bus queue waits and bus time per device ('i2c reset' clears)",
+        [](Stream& out, const String& args) {
+            if (args == "reset") {
+                i2cBus.resetStats();
+                out.println("I2C bus stats cleared");
+                return;
+            }
+            i2cBus.printStats(out);
+        });
+    commandInterface.addCommand("trace", "CC24-to-PWM latency ('trace on|off|reset')",
+        [](Stream& out, const String& args) {
+            if (args == "on") {
+                tracer.setEnabled(true);
+            } else if (args == "off") {
+                tracer.setEnabled(false);
+            } else if (args == "reset") {
+                tracer.clear();
+                out.println("Trace cleared");
+                return;
+            }
+            tracer.printReport(out);
+        });
+    commandInterface.addCommand("pressure", "LPS28 bursts and CC25 traffic ('pressure odr|wtm|deadband|heartbeat <x>', 'pressure reset')",
+        [](Stream& out, const String& args) {
+            int space = args.indexOf(' ');
+            String name = space > 0 ? args.substring(0, space) : args;
+            String value = space > 0 ? args.substring(space + 1) : "";
+            if (name == "reset") {
+                pressureSampler.resetStats();
+                cc25Sent = 0;
+                cc25Suppressed = 0;
+                out.println("Pressure stats cleared");
+                return;
+            } else if (name == "odr" && space > 0) {
+                if (!pressureSampler.setDataRate(value.toInt())) {
+                    out.println("ODR must be 1, 4, 10, 25, 50, 75, 100 or 200 Hz");
+                }
+            } else if (name == "wtm" && space > 0) {
+                pressureSampler.setWatermark(value.toInt());
+            } else if (name == "deadband" && space > 0) {
+                cc25DeadbandHPa = value.toFloat();
+            } else if (name == "heartbeat" && space > 0) {
+                cc25HeartbeatMs = value.toInt();
+            }
+            pressureSampler.printStats(out);
+            out.print("CC25: ");
+            out.print(cc25Sent);
+            out.print(" sent, ");
+            out.print(cc25Suppressed);
+            out.print(" suppressed (deadband ");
+            out.print(cc25DeadbandHPa, 2);
+            out.print(" hPa, heartbeat ");
+            out.print(cc25HeartbeatMs);
+            out.print(" ms), last value ");
+            out.println(pressureMidiValue);
+        });
+    commandInterface.addCommand("airpid", "Pressure regulation ('airpid on|off|zero', 'airpid kp|ki|kd <x>', 'airpid sim <hPa>')",
+        [](Stream& out, const String& args) {
+            int space = args.indexOf(' ');
+            String name = space > 0 ? args.substring(0, space) : args;
+            float value = space > 0 ? args.substring(space + 1).toFloat() : 0;
+            if (name == "on" || name == "off") {
+                if (!setPressureRegulation(name == "on")) {
+                    out.println("No pressure sensor: open loop only");
+                    return;
+                }
+            } else if (name == "zero") {
+                if (!pressureSensorFitted) {
+                    out.println("No pressure sensor: open loop only");
+                    return;
+                }
+                startAmbientZero();
+            } else if (name == "kp" && space > 0) {
+                airController.setGains(value, airController.getKi(), airController.getKd());
+            } else if (name == "ki" && space > 0) {
+                airController.setGains(airController.getKp(), value, airController.getKd());
+            } else if (name == "kd" && space > 0) {
+                airController.setGains(airController.getKp(), airController.getKi(), value);
+            } else if (name == "sim" && space > 0) {
+                // Same gains and limits against the plant model, at the sensor rate
+                PIDController model(airController.getKp(), airController.getKi(), airController.getKd());
+                model.setIntegralLimit(AIR_INTEGRAL_LIMIT);
+                model.setOutputRateLimit(AIR_OUTPUT_RATE_PER_S);
+                float dtS = 1.0f / pressureSampler.getDataRate();
+                out.print("Simulated step, ");
+                out.print(dtS * 1000, 1);
+                out.println(" ms per sample:");
+                printStepMetrics(out, simulateStep(model, AirPlantModel(), value, dtS, 20.0f));
+                return;
+            }
+            out.print("Pressure regulation: ");
+            out.print(pressureRegulation ? "on" : "off (CC24 sets pump speed)");
+            out.print(", kp ");
+            out.print(airController.getKp(), 4);
+            out.print(", ki ");
+            out.print(airController.getKi(), 4);
+            out.print(", kd ");
+            out.println(airController.getKd(), 4);
+            out.print("  Target ");
+            if (airTargetActive) out.print(airTargetHPa, 1); else out.print("-");
+            out.print(" hPa (ramped ");
+            out.print(airRampedTargetHPa, 1);
+            out.print("), measured ");
+            out.print(filteredGaugeHPa, 2);
+            out.print(" hPa above ");
+            out.print(ambientHPa, 1);
+            out.print(", command ");
+            out.print(airCommand, 3);
+            out.print(", integral ");
+            out.print(airController.getIntegral(), 3);
+            out.println(airController.isSaturated() ? " (saturated)" : "");
+            if (airStep.isActive()) {
+                printStepMetrics(out, airStep.get());
+            }
+        });
+    commandInterface.addCommand("envelope", "Stored air envelopes ('envelope <n> [once]', 'envelope stop|reset')",
+        [](Stream& out, const String& args) {
+            if (args == "stop") {
+                playAirEnvelope(0, false);
+            } else if (args == "reset") {
+                airEnvelope.resetTimingStats();
+                out.println("Envelope stats cleared");
+                return;
+            } else if (args.length() > 0) {
+                int space = args.indexOf(' ');
+                long number = (space > 0 ? args.substring(0, space) : args).toInt();
+                bool once = space > 0 && args.substring(space + 1) == "once";
+                if (number < 1 || !playAirEnvelope(number, !once)) {
+                    out.print("Envelope must be 1..");
+                    out.print(NUM_AIR_ENVELOPES);
+                    out.println(" and the air armed");
+                }
+            }
+            out.print("Air envelope: ");
+            out.print(airEnvelope.isPlaying() ? "playing" : "idle");
+            out.print(" (Program Change 1..");
+            out.print(NUM_AIR_ENVELOPES);
+            out.println(" plays, 0 stops)");
+            airEnvelope.printTimingStats(out);
+        });
+    commandInterface.addCommand("guard", "Pressure cutoff ('guard inject|stall|rearm|reset')",
+        [](Stream& out, const String& args) {
+            if (args == "inject") {
+                // Next guard read acts as an overpressure
+                injectedFaultUs.store((uint32_t)esp_timer_get_time());
+                out.println("Fault injected");
+                return;
+            } else if (args == "stall") {
+                // Stop the guard task; the watchdog cuts if a pump runs
+                vTaskSuspend(guardTask);
+                out.println("Pressure guard paused ('guard rearm' resumes)");
+                return;
+            } else if (args == "rearm") {
+                stopAirRegulation();
+                airEncoder.setValue(64);
+                currentAirLevel = 64;
+                vTaskResume(guardTask);
+                airCutoff.rearm();
+                cutoffReported = false;
+                out.println("Air rearmed, all motors off");
+            } else if (args == "reset") {
+                airCutoff.resetStats();
+                out.println("Guard stats cleared");
+                return;
+            }
+            SafetyCutoff::Stats stats = airCutoff.getStats();
+            out.print("Pressure cutoff: ");
+            if (!pressureSensorFitted) {
+                out.println("off (no pressure sensor, open loop)");
+                return;
+            }
+            out.print(airCutoff.isTripped() ? "TRIPPED" : "armed");
+            out.print(", limits ");
+            out.print(UNDERPRESSURE_HPA, 0);
+            out.print("/+");
+            out.print(OVERPRESSURE_HPA, 0);
+            out.print(" hPa, guard reads ");
+            out.print(guardPressureHPa - ambientHPa, 1);
+            out.println(" hPa");
+            out.print("  Trips ");
+            out.print(stats.trips);
+            out.print(", last ");
+            out.print(cutoffReasonName(stats.lastReason));
+            out.print(" in ");
+            out.print(stats.lastLatencyUs);
+            out.print(" us, max ");
+            out.print(stats.maxLatencyUs);
+            out.println(" us (detection to pins)");
+        });
+    commandInterface.addCommand("airhold", "Leak-compensating pulse hold ('airhold on|off', 'airhold band <hPa>')",
+        [](Stream& out, const String& args) {
+            if (args == "on" || args == "off") {
+                leakHoldEnabled = args == "on";
+                if (!leakHoldEnabled && holding) {
+                    exitHold();
+                    airController.reset(0);
+                }
+            } else if (args.startsWith("band ")) {
+                float band = args.substring(5).toFloat();
+                if (band > 0) leakHold.setBand(band);
+            }
+            float timeS = (lastPressureSampleUs - holdStartUs) * 1e-6f;
+            out.print("Leak hold: ");
+            out.print(leakHoldEnabled ? "on" : "off");
+            out.print(holding ? " (holding" : " (not holding");
+            out.print(", band +-");
+            out.print(leakHold.getBand(), 1);
+            out.println(" hPa)");
+            out.print("  Leak ");
+            out.print(leakHold.getLeakPerS(), 4);
+            out.print(" /s (");
+            out.print(leakHold.getLeakHPaPerS(airTargetHPa), 3);
+            out.print(" hPa/s at the target), pump ");
+            out.print(leakHold.getPumpGainHPaPerS(), 1);
+            out.println(" hPa per pulse second");
+            if (holding) {
+                out.print("  Pulses ");
+                out.print(leakHold.getPulses());
+                out.print(" in ");
+                out.print(timeS, 0);
+                out.print(" s, pump duty ");
+                out.print(leakHold.getDutyCycle(timeS) * 100, 2);
+                out.println("%");
+            }
+        });
     
     Serial.println("Routing configured:");
     Serial.println("  Route 1: Air Encoder → CC24 → Bluetooth Out (transmission)");
     Serial.println("  Route 2: Bluetooth In → CC24 → Air Control (external control)");
     Serial.println("  Route 3: Air Encoder → CC24 → Air Control (direct control)");
-    Serial.println("  Route 4: LPS28 Pressure Sensor → CC25 → Bluetooth Out (every 100ms)");
+    Serial.println("  Route 4: LPS28 Pressure Sensor → CC25 → Bluetooth Out (on change + heartbeat)");
     Serial.println("  Route 5: Encoder Reset Button → D12 (GPIO 47) → Emergency Stop");
+    if (LPS28_INT_PIN >= 0) {
+        Serial.print("  Guard: LPS28 INT → GPIO ");
+        Serial.print(LPS28_INT_PIN);
+        Serial.println(" → Cutoff, plus 200 Hz software check");
+    } else if (pressureSensorFitted) {
+        Serial.println("  Guard: 200 Hz software check (LPS28 INT not wired)");
+    }
     Serial.println("Ready!");
 }
 
 void loop() {
     // Update all MIDI processing and routing
     Control_Surface.loop();
+    blePacker.update();
     delay(5); // Limit control surface processing.
     
     digitalWrite(LED_BUILTIN, midibt.isConnected() ? HIGH : LOW);
 
+    if (airCutoff.isTripped() && !cutoffReported) {
+        // The pins are already safe; bring the control state in line
+        cutoffReported = true;
+        stopAirRegulation();
+        airEncoder.setValue(64);
+        currentAirLevel = 64;
+        SafetyCutoff::Stats stats = airCutoff.getStats();
+        Serial.print("AIR CUT OFF: ");
+        Serial.print(cutoffReasonName(stats.lastReason));
+        Serial.print(", ");
+        Serial.print(stats.lastLatencyUs);
+        Serial.println(" us to pins safe ('guard rearm' to restore)");
+    }
+
     // Check for encoder reset button press
     if (encoderResetButton.update() && encoderResetButton.getState() == Button::Falling) {
         // Reset encoder to center position (64) - stops pump
         airEncoder.setValue(64);
         currentAirLevel = 64;
         
-        // Immediately stop all motors
-        for (int i = 0; i < 4; i++) {
-            ledcWrite(PWM_CHANNELS[i], 0);
-        }
+        // Immediately stop all motors (and the regulator until the next CC24)
+        stopAirRegulation();
         
         Serial.println("ENCODER RESET BUTTON PRESSED - Pump stopped (CC24=64)");
     }
@@ -1,8 +1,15 @@
 #include <Arduino.h>
 #include <Control_Surface.h>
-#include <Adafruit_INA219.h>
 #include "cli.h"
 #include "ledcontrol.h"
+#include "i2cbus.h"
+#include "trace.h"
+#include "powersampler.h"
+#include "controlloop.h"
+#include "heatoutput.h"
+#include "safetycutoff.h"
+#include "envelopeplayer.h"
+#include "blemidipacker.h"
 
 // MIDI Interface
 BluetoothMIDI_Interface midibt;
@@ -13,17 +20,30 @@ CLI commandInterface(Serial, midibt);
 // LED Controller
 LEDController ledController;
 
-// INA219 Current Sensor
-Adafruit_INA219 ina219;
+// INA219 Current Sensor (hardware averaging, own task)
+PowerSampler powerSampler;
 
 // Heat control PWM setup
 const uint8_t HEAT_PIN = 18;        // GPIO pin for MOSFET M1
 const uint8_t HEAT_PWM_CHANNEL = 0; // PWM channel for heat control
-volatile uint8_t currentHeatLevel = 0; // Current heat level (0-127)
+const double HEAT_PWM_NOMINAL_HZ = 1000.0; // Until locked to the INA219 ADC
+HeatOutput heatOutput {HEAT_PIN, HEAT_PWM_CHANNEL}; // 12-bit PWM + 4-bit dithering
+volatile uint8_t currentHeatLevel = 0; // Current heat level (0-127, CC23)
 
-// Timing for INA219 readings
-unsigned long lastINA219Reading = 0;
-const unsigned long INA219_INTERVAL = 50; // Read every 50ms
+// 14-bit heat setpoint: CC23 is the MSB, CC55 (23 + 32) the optional LSB.
+// Per the MIDI spec a new MSB clears the LSB, so 7-bit senders still work.
+const uint8_t CC_HEAT_LSB = 55;
+const uint16_t HEAT_SETPOINT_MAX = 16383;
+uint16_t heatSetpoint = 0;
+
+// PWM lock to the INA219 sample window (see syncHeatPwmToSampler)
+unsigned long lastPwmSync = 0;
+const unsigned long PWM_SYNC_INTERVAL = 10000; // Re-check every 10 s
+const double PWM_SYNC_TOLERANCE = 0.002;       // Retune when off by more than 0.2%
+
+// Timing for INA219 log output (the limiter runs on every snapshot)
+unsigned long lastINA219Log = 0;
+const unsigned long INA219_LOG_INTERVAL = 50; // Print every 50ms
 
 // Power limiting variables
 const float MAX_POWER_W = 8.0; // Maximum allowed power in watts
@@ -31,6 +51,87 @@ uint8_t maxAllowedHeatLevel = 127; // Auto-discovered power limit (starts at max
 float averagePower = 0.0; // Running average power
 bool powerLimitActive = false; // Flag to indicate if power limiting is active
 
+// Power regulation ('heatpi on'): CC23 sets a target power, a PI loop sets
+// the PWM duty on every INA219 snapshot. Off (default) = legacy mode, CC23
+// sets the duty directly and the limiter above latches a ceiling.
+const float HEAT_KP = 0.02;  // Duty per watt of error
+const float HEAT_KI = 2.0;   // Duty per watt-second of error
+const float MAX_REGULATION_DT_S = 0.1; // Longer gaps (sampler stalled) count as this
+volatile bool powerRegulation = false;
+float heatTargetW = 0.0;       // Set by CC23 or a playing envelope
+float regulatorSetpointW = 0.0; // What the PI loop follows (boost or target)
+float heatDuty = 0.0;
+uint32_t lastSnapshotUs = 0;
+bool heatTracePending = false;
+PIController heatController {HEAT_KP, HEAT_KI};
+StepMetrics heatStep;
+uint32_t heatStepStartUs = 0;
+
+// Fast warm-up: with no temperature sensor the pad temperature is
+// estimated from the measured power. After a target increase the loop
+// boosts at MAX_POWER_W until the estimate reaches the temperature the
+// target power holds, then holds the target.
+const float PAD_HEAT_CAPACITY_J_PER_C = 15.0; // Pad and cover
+const float PAD_LOSS_W_PER_C = 0.12;          // To the skin and air (time constant ~2 min)
+const float REBOOST_FRACTION = 0.1;           // Boost again when 10% below the hold temperature
+ThermalEstimator padThermal {PAD_HEAT_CAPACITY_J_PER_C, PAD_LOSS_W_PER_C};
+bool warmupBoostEnabled = true;
+bool warmupBoosting = false;
+uint32_t boostStartMs = 0;
+uint32_t lastBoostMs = 0;  // Duration of the last boost
+
+// Overcurrent cutoff: checked on the sampler task on every conversion,
+// independent of the loop, and a timer ISR cuts the output if the sampler
+// stops delivering while the pad is driven. The cut holds until `guard rearm`.
+const float OVERCURRENT_A = 1.6;            // Full duty draws ~1.2 A
+const uint32_t GUARD_WATCHDOG_PERIOD_US = 2000;
+const uint32_t SENSOR_TIMEOUT_US = 100000;  // ~4 conversions without a reading
+const uint8_t SAMPLER_PRIORITY = 10;        // Above the loop and BLE host tasks
+enum CutoffReason : uint8_t {
+    CUTOFF_OVERCURRENT = 1,
+    CUTOFF_SHUNT_OVERFLOW,
+    CUTOFF_SENSOR_STALE,
+    CUTOFF_INJECTED,
+};
+SafetyCutoff heatCutoff;
+hw_timer_t* guardTimer = nullptr;
+std::atomic<uint32_t> injectedFaultUs{0};   // `guard inject`: time of the fake fault
+bool cutoffReported = false;
+
+// Stored heat envelopes, played by their own task (Program Change 1..N or
+// `envelope <n>`; 0, CC23 or `envelope stop` ends them). With power
+// regulation on an envelope is a power profile the PI loop follows,
+// amplitude 255 = MAX_POWER_W; off, it drives the PWM open loop, amplitude
+// 255 = ENVELOPE_MAX_DUTY. Step times in ms.
+const float ENVELOPE_MAX_DUTY = 0.74;  // ~MAX_POWER_W of the ~10.8 W at full duty
+constexpr HapticStep HEAT_PULSE_STEPS[] = {{255, 2000}, {0, 3000}};
+constexpr HapticStep HEAT_WAVE_STEPS[] = {
+    {32, 1000}, {64, 1000}, {96, 1000}, {128, 1000}, {160, 1000}, {192, 1000}, {224, 1000},
+    {255, 4000},
+    {224, 1000}, {192, 1000}, {160, 1000}, {128, 1000}, {96, 1000}, {64, 1000}, {32, 1000},
+    {0, 4000}
+};
+constexpr HapticStep HEAT_FLICKER_STEPS[] = {{255, 300}, {0, 200}, {255, 300}, {0, 1200}};
+constexpr HapticEffect HEAT_PULSE = makeEffect(HEAT_PULSE_STEPS);
+constexpr HapticEffect HEAT_WAVE = makeEffect(HEAT_WAVE_STEPS);
+constexpr HapticEffect HEAT_FLICKER = makeEffect(HEAT_FLICKER_STEPS);
+const HapticEffect* const HEAT_ENVELOPES[] = {&HEAT_PULSE, &HEAT_WAVE, &HEAT_FLICKER};
+const uint8_t NUM_HEAT_ENVELOPES = sizeof(HEAT_ENVELOPES) / sizeof(HEAT_ENVELOPES[0]);
+
+std::atomic<float> envelopeTargetW{0};     // Envelope task -> loop
+std::atomic<bool> envelopeTargetPending{false};
+
+// Runs on the envelope task
+void heatEnvelopeOutput(uint8_t amplitude, void*) {
+    if (powerRegulation) {
+        envelopeTargetW.store(amplitude * MAX_POWER_W / 255);
+        envelopeTargetPending.store(true);
+    } else {
+        heatOutput.setDuty(amplitude * ENVELOPE_MAX_DUTY / 255);
+    }
+}
+EnvelopePlayer heatEnvelope {heatEnvelopeOutput, nullptr, 0};
+
 // Heat Control Encoder - sends CC23 MIDI messages
 CCAbsoluteEncoder heatEncoder {
     {38, 21},  // Encoder pins (swapped for clockwise increase)
@@ -38,6 +139,195 @@ CCAbsoluteEncoder heatEncoder {
     6           // Multiplier
 };
 
+const char* cutoffReasonName(uint8_t reason) {
+    switch (reason) {
+        case CUTOFF_OVERCURRENT: return "overcurrent";
+        case CUTOFF_SHUNT_OVERFLOW: return "shunt overflow";
+        case CUTOFF_SENSOR_STALE: return "INA219 stalled";
+        case CUTOFF_INJECTED: return "injected fault";
+        default: return "none";
+    }
+}
+
+/**
+ * @brief Overcurrent check, runs on the sampler task with every conversion
+ *
+ * The INA219 has no alert pin or comparator, so the earliest a fault can
+ * be seen is the conversion that covers it: worst case one conversion
+ * (~21 ms) plus the register reads, whatever the loop is doing.
+ */
+void heatGuard(const PowerSnapshot& snapshot, void*) {
+    uint32_t injected = injectedFaultUs.exchange(0);
+    if (injected != 0) {
+        // Measured from the injection, so it includes waiting for the conversion
+        heatCutoff.trip(injected, CUTOFF_INJECTED);
+    } else if (snapshot.overflow) {
+        heatCutoff.trip(snapshot.timeUs, CUTOFF_SHUNT_OVERFLOW);
+    } else if (snapshot.current_A > OVERCURRENT_A) {
+        heatCutoff.trip(snapshot.timeUs, CUTOFF_OVERCURRENT);
+    }
+}
+
+/**
+ * @brief Sensor watchdog: no INA219 reading while the pad is driven means
+ * nothing is watching the current, so cut the output
+ */
+void IRAM_ATTR guardWatchdogISR() {
+    if (heatOutput.getDutyRaw() == 0 || heatCutoff.isTripped()) {
+        return;
+    }
+    uint32_t deadline = powerSampler.getLastSnapshotUs() + SENSOR_TIMEOUT_US;
+    if ((int32_t)((uint32_t)esp_timer_get_time() - deadline) > 0) {
+        heatCutoff.trip(deadline, CUTOFF_SENSOR_STALE);
+    }
+}
+
+void writeHeatDuty(float duty) {
+    heatDuty = duty;
+    heatOutput.setDuty(duty);
+}
+
+/**
+ * @brief Set the regulated power; the PI loop follows on the next snapshot
+ *
+ * @param traced The change comes from a traced CC23 (not an envelope step)
+ */
+void setHeatTarget(float watts, bool traced = true) {
+    if (watts == heatTargetW) {
+        return;
+    }
+    heatTargetW = watts;
+    heatTracePending = heatTracePending || traced;
+    if (watts <= 0) {
+        // Off is not regulated: cut the output right away
+        heatController.reset(0);
+        writeHeatDuty(0);
+        if (heatTracePending) {
+            tracer.stamp(TracePath::CC23Heat, TraceStage::Actuator);
+            heatTracePending = false;
+        }
+    }
+}
+
+/**
+ * @brief Power the PI loop should deliver now: boost or the target
+ */
+float warmupSetpoint() {
+    if (heatTargetW <= 0 || heatEnvelope.isPlaying()) {
+        warmupBoosting = false;  // A boost would flatten the envelope's shape
+        return heatTargetW > 0 ? heatTargetW : 0;
+    }
+    float holdRise = padThermal.steadyStateRise(heatTargetW);
+    float rise = padThermal.getRise();
+
+    if (warmupBoosting) {
+        if (!warmupBoostEnabled || rise >= holdRise) {
+            warmupBoosting = false;
+            lastBoostMs = millis() - boostStartMs;
+            // Start the hold near its duty instead of winding down from full
+            heatController.reset(heatDuty * heatTargetW / MAX_POWER_W);
+            Serial.print("Warm-up: boost done after ");
+            Serial.print(lastBoostMs / 1000.0, 1);
+            Serial.println(" s, holding");
+        }
+    } else if (warmupBoostEnabled && heatTargetW < MAX_POWER_W && rise < holdRise * (1 - REBOOST_FRACTION)) {
+        warmupBoosting = true;
+        boostStartMs = millis();
+        Serial.print("Warm-up: boosting at ");
+        Serial.print(MAX_POWER_W, 1);
+        Serial.print(" W to an estimated +");
+        Serial.print(holdRise, 1);
+        Serial.println(" C");
+    }
+    return warmupBoosting ? MAX_POWER_W : heatTargetW;
+}
+
+/**
+ * @brief One PI step on an INA219 snapshot
+ */
+void regulateHeat(const PowerSnapshot& snapshot, float dtS) {
+    float setpoint = warmupSetpoint();
+    float stepTimeS = (snapshot.timeUs - heatStepStartUs) * 1e-6f;
+    if (setpoint != regulatorSetpointW) {
+        heatStepStartUs = snapshot.timeUs;
+        heatStep.begin(0, snapshot.power_W, setpoint);
+        regulatorSetpointW = setpoint;
+    } else {
+        heatStep.add(stepTimeS, snapshot.power_W);
+    }
+    if (setpoint <= 0) {
+        return;
+    }
+    writeHeatDuty(heatController.update(setpoint, snapshot.power_W, dtS));
+    if (heatTracePending) {
+        tracer.stamp(TracePath::CC23Heat, TraceStage::Actuator);
+        heatTracePending = false;
+    }
+}
+
+/**
+ * @brief Switch between power regulation and direct duty control
+ */
+void setPowerRegulation(bool on) {
+    if (on == powerRegulation) {
+        return;
+    }
+    heatEnvelope.stop();  // Its rest output goes where the old mode expects
+    envelopeTargetPending = false;
+    powerRegulation = on;
+    maxAllowedHeatLevel = 127;
+    powerLimitActive = false;
+    heatTargetW = 0;
+    if (on) {
+        heatController.reset(heatDuty);  // Bumpless: start from the current duty
+        setHeatTarget(heatSetpoint * MAX_POWER_W / HEAT_SETPOINT_MAX);
+    } else {
+        writeHeatDuty(heatSetpoint / (float)HEAT_SETPOINT_MAX);
+    }
+}
+
+void printStepMetrics(Stream& out, const StepMetrics::Result& r) {
+    out.print("  Step ");
+    out.print(r.from, 2);
+    out.print(" -> ");
+    out.print(r.target, 2);
+    out.print(" W: rise ");
+    if (r.riseTimeS < 0) out.print("-"); else out.print(r.riseTimeS * 1000, 0);
+    out.print(" ms, settling ");
+    if (r.settlingTimeS < 0) out.print("-"); else out.print(r.settlingTimeS * 1000, 0);
+    out.print(" ms, overshoot ");
+    out.print(r.overshootPct, 1);
+    out.print("%, steady-state error ");
+    out.print(r.steadyStateError, 3);
+    out.print(" W (");
+    out.print(r.samples);
+    out.println(" samples)");
+}
+
+/**
+ * @brief Start a stored envelope (1..NUM_HEAT_ENVELOPES), 0 stops
+ *
+ * With power regulation on the envelope sets the power target and ends
+ * at 0 W; off, it owns the PWM while it plays and CC23 duty control
+ * resumes after.
+ */
+bool playHeatEnvelope(uint8_t number, bool loop) {
+    if (number == 0) {
+        if (heatEnvelope.isPlaying()) {
+            heatEnvelope.stop();
+        }
+        return true;
+    }
+    if (heatCutoff.isTripped() || number > NUM_HEAT_ENVELOPES) {
+        return false;
+    }
+    heatEnvelope.play(HEAT_ENVELOPES[number - 1], loop);
+    Serial.print("Heat envelope ");
+    Serial.print(number);
+    Serial.println(loop ? " (looping)" : "");
+    return true;
+}
+
 /**
  * @brief Custom MIDI sink for heat control
  * 
@@ -49,38 +339,75 @@ public:
     HeatControlSink() {}
     
     void sinkMIDIfromPipe(ChannelMessage msg) override {
-        // Handle CC 23 messages for heat control
-        if (msg.getMessageType() == MIDIMessageType::ControlChange && 
-            msg.getData1() == 23) {
-            
-            uint8_t requestedHeatLevel = msg.getData2();
-            
-            // Apply power limiting: clamp to discovered maximum
-            currentHeatLevel = min(requestedHeatLevel, maxAllowedHeatLevel);
-            
-            // Convert CC23 value (0-127) to PWM duty cycle (0-255)
-            uint8_t pwmValue = (currentHeatLevel * 255) / 127;
-            ledcWrite(HEAT_PWM_CHANNEL, pwmValue);
-            
-            // Check if power limiting is active
-            if (requestedHeatLevel > maxAllowedHeatLevel) {
-                powerLimitActive = true;
-            } else {
-                powerLimitActive = false;
-            }
-            
-            Serial.print("Heat level: ");
-            Serial.print((currentHeatLevel * 100) / 127);
-            Serial.print("% (CC23=");
-            Serial.print(currentHeatLevel);
-            if (powerLimitActive) {
-                Serial.print(" POWER LIMITED from ");
-                Serial.print(requestedHeatLevel);
-            }
-            Serial.print(", PWM=");
-            Serial.print(pwmValue);
+        if (msg.getMessageType() == MIDIMessageType::ProgramChange) {
+            playHeatEnvelope(msg.getData1(), true);
+            return;
+        }
+        if (msg.getMessageType() != MIDIMessageType::ControlChange) {
+            return;
+        }
+        // Handle CC 23 (MSB) and CC 55 (LSB) messages for heat control
+        uint16_t requested;
+        if (msg.getData1() == 23) {
+            tracer.stamp(TracePath::CC23Heat, TraceStage::Sink);
+            requested = msg.getData2() << 7;
+        } else if (msg.getData1() == CC_HEAT_LSB) {
+            requested = (heatSetpoint & ~0x7F) | msg.getData2();
+        } else {
+            return;
+        }
+        if (heatCutoff.isTripped()) {
+            Serial.println("Heat cut off by the overcurrent guard, 'guard rearm' to restore");
+            return;
+        }
+        if (heatEnvelope.isPlaying()) {
+            // Live control takes over from the envelope: no rest output to race the write below
+            heatEnvelope.release();
+            envelopeTargetPending = false;  // A step it left behind must not undo this CC
+            heatController.reset(heatDuty);
+        }
+        heatSetpoint = requested;
+        uint8_t requestedHeatLevel = requested >> 7;
+        
+        if (powerRegulation) {
+            // The setpoint is a power target, full scale = MAX_POWER_W
+            currentHeatLevel = requestedHeatLevel;
+            setHeatTarget(requested * MAX_POWER_W / HEAT_SETPOINT_MAX);
+            Serial.print("Heat target: ");
+            Serial.print(heatTargetW, 3);
+            Serial.print(" W (CC23/55=");
+            Serial.print(requested);
             Serial.println(")");
+            return;
+        }
+        
+        // Apply power limiting: clamp to discovered maximum
+        currentHeatLevel = min(requestedHeatLevel, maxAllowedHeatLevel);
+        uint16_t limit = maxAllowedHeatLevel < 127 ? maxAllowedHeatLevel << 7 : HEAT_SETPOINT_MAX;
+        uint16_t level = min(requested, limit);
+        
+        // 14-bit setpoint to duty cycle
+        writeHeatDuty(level / (float)HEAT_SETPOINT_MAX);
+        tracer.stamp(TracePath::CC23Heat, TraceStage::Actuator);
+        
+        // Check if power limiting is active
+        if (requested > limit) {
+            powerLimitActive = true;
+        } else {
+            powerLimitActive = false;
+        }
+        
+        Serial.print("Heat level: ");
+        Serial.print(level * 100.0 / HEAT_SETPOINT_MAX, 2);
+        Serial.print("% (CC23/55=");
+        Serial.print(level);
+        if (powerLimitActive) {
+            Serial.print(" POWER LIMITED from ");
+            Serial.print(requested);
         }
+        Serial.print(", duty=");
+        Serial.print(heatOutput.getDutyRaw());
+        Serial.println(")");
     }
     
     // Required overrides for other MIDI message types (no-op for our use case)
@@ -89,32 +416,44 @@ public:
     void sinkMIDIfromPipe(RealTimeMessage) override {}
 };
 
-// Structure to hold averaged sensor readings
-struct AveragedReadings {
-    float current_A;
-    float voltage_V;
-    float power_W;
-};
-
-// Function to get averaged readings from multiple samples
-AveragedReadings getAveragedReadings(int numSamples = 10) {
-    float totalCurrent = 0.0;
-    float totalVoltage = 0.0;
-    float totalPower = 0.0;
-    
-    for (int i = 0; i < numSamples; i++) {
-        totalCurrent += ina219.getCurrent_mA();
-        totalVoltage += ina219.getBusVoltage_V();
-        totalPower += ina219.getPower_mW();
-        delay(1); // Small delay between samples
+/**
+ * @brief Lock the heat PWM to the INA219 ADC
+ *
+ * The pad draws current only during the on-time, so a sample that covers
+ * a fraction of a PWM period more or less than another reads a different
+ * current: at 1 kHz against the ~532 us sample window this aliased into
+ * a slow 0.05-1.2 A swing at a constant setting (tools/heat/heat.txt).
+ * With a whole number of PWM periods per sample every sample averages the
+ * true duty cycle, whatever the phase. The window comes from the measured
+ * conversion period, since the INA219 oscillator is only nominal.
+ * 
+ * The number of periods is the one closest to HEAT_PWM_NOMINAL_HZ
+ * (one period, ~1.88 kHz).
+ */
+void syncHeatPwmToSampler() {
+    float windowUs = powerSampler.getSampleWindowUs();
+    if (windowUs <= 0) {
+        return;  // Not measured yet
     }
-    
-    AveragedReadings readings;
-    readings.current_A = (totalCurrent / numSamples) / 1000.0; // Convert mA to A
-    readings.voltage_V = totalVoltage / numSamples;
-    readings.power_W = (totalPower / numSamples) / 1000.0; // Convert mW to W
-    
-    return readings;
+    double periods = max(1.0, round(windowUs * 1e-6 * HEAT_PWM_NOMINAL_HZ));
+    double frequency = periods * 1e6 / windowUs;
+    double current = heatOutput.getFrequency();
+    if (fabs(frequency - current) <= current * PWM_SYNC_TOLERANCE) {
+        return;
+    }
+    // Keeps the duty cycle, only the timer is retuned
+    double actual = heatOutput.setFrequency(frequency);
+    if (actual <= 0) {
+        Serial.println("PWM sync: could not set heat PWM frequency");
+        return;
+    }
+    Serial.print("PWM sync: heat PWM ");
+    Serial.print(actual, 1);
+    Serial.print(" Hz, ");
+    Serial.print((int)periods);
+    Serial.print(" period(s) per ");
+    Serial.print(windowUs, 1);
+    Serial.println(" us INA219 sample");
 }
 
 // Instantiate the heat control sink
@@ -137,47 +476,63 @@ HeatControlSink heatSink;
  *  └─────────────────┘    └──────────────┘
  */
 
-// Pipe factory for proper routing management (need 2 pipes for separation of concerns)
-MIDI_PipeFactory<3> pipeFactory;
+// Transmit packer: one BLE-MIDI packet per connection interval (Route 2; the heat routes use tracing pipes)
+BLEMIDIPacker blePacker {midibt};
+
+// CC23 latency stamps as messages enter the heat routes (CLI `trace`)
+TracingPipe encoderTracePipe {23, TracePath::CC23Heat, TraceStage::Input};
+TracingPipe bleTracePipe {23, TracePath::CC23Heat, TraceStage::Input};
 
 void setup() {
     Serial.begin(115200);
     Serial.println("=== HBITS Heat Controller ===");
     
+    // Shared I2C bus (LED ring, INA219)
+    i2cBus.begin();
+    
     // Initialize PWM for heat control
-    ledcSetup(HEAT_PWM_CHANNEL, 1000, 8); // 1kHz, 8-bit resolution
-    ledcAttachPin(HEAT_PIN, HEAT_PWM_CHANNEL);
-    ledcWrite(HEAT_PWM_CHANNEL, 0); // Start with heat off
+    heatOutput.begin(HEAT_PWM_NOMINAL_HZ); // Starts off; 1kHz until synced to the INA219
+    heatCutoff.addPin(HEAT_PIN, HEAT_PWM_CHANNEL, LOW);
+    if (!heatEnvelope.begin()) {
+        Serial.println("Heat envelopes unavailable: no step timer");
+    }
     
     Serial.println("PWM heat control initialized on pin 18");
     
-    // Initialize INA219 current sensor
-    if (!ina219.begin()) {
+    // Initialize INA219 current sensor (32V, 2A range, sampled by its own task)
+    powerSampler.setGuard(heatGuard, nullptr);
+    if (!powerSampler.begin(PowerSampler::ADC_SAMPLES_32, PowerSampler::ADC_SAMPLES_8, SAMPLER_PRIORITY)) {
         Serial.println("ERROR: Failed to find INA219 sensor!");
         Serial.println("Check wiring and I2C address (default 0x40)");
+        Serial.println("Heat stays cut off without current readings");
     } else {
-        Serial.println("INA219 current sensor initialized");
-        // Optional: set calibration for higher precision if needed
-        // ina219.setCalibration_32V_2A();  // 32V, 2A max (default)
-        // ina219.setCalibration_32V_1A();  // 32V, 1A max (higher precision)
-        // ina219.setCalibration_16V_400mA(); // 16V, 400mA max (highest precision)
+        Serial.print("INA219 current sensor initialized, ");
+        Serial.print(powerSampler.getConversionTimeUs());
+        Serial.println(" us per averaged conversion");
     }
     
+    // Sensor watchdog, 1 MHz timer
+    guardTimer = timerBegin(1, 80, true);
+    timerAttachInterrupt(guardTimer, &guardWatchdogISR, true);
+    timerAlarmWrite(guardTimer, GUARD_WATCHDOG_PERIOD_US, true);
+    timerAlarmEnable(guardTimer);
+    
     // Set up clean pipe-based routing BEFORE Control_Surface.begin()
     // Two explicit, unidirectional routes for clear separation of concerns:
     // 
 
     // Route 1: Control_Surface (FSR) → HeatSink (standalone haptic control)
-    Control_Surface >> pipeFactory >> heatSink;
+    Control_Surface >> encoderTracePipe >> heatSink;
     
     // Route 2: Control_Surface (Heat Encoder) → Bluetooth (CC23 transmission)
-    Control_Surface >> pipeFactory >> midibt;
+    Control_Surface >> blePacker >> midibt;
     
     // Route 3: Bluetooth → HeatSink (external MIDI control of heat)
-    midibt >> pipeFactory >> heatSink;
+    midibt >> bleTracePipe >> heatSink;
     
     // Set Bluetooth device name
     midibt.setName("HEAT bit 1 MST");
+    blePacker.begin();
     
     // Initialize LED controller
     ledController.begin();
@@ -187,6 +542,206 @@ void setup() {
             
     // Initialize CLI
     commandInterface.begin();
+    commandInterface.addCommand("blemidi", "Bluetooth MIDI packing: packets/s, messages per packet, queueing ('blemidi interval <ms>|reset')",
+        [](Stream& out, const String& args) {
+            if (args.startsWith("interval")) {
+                long ms = args.substring(8).toInt();
+                if (ms > 0) {
+                    blePacker.setInterval(ms);
+                }
+            } else if (args == "reset") {
+                blePacker.resetStats();
+                out.println("BLE MIDI stats cleared");
+                return;
+            }
+            blePacker.printStats(out);
+        });
+    commandInterface.addCommand("regs", "Register cache hits: writes issued vs suppressed",
+        [](Stream& out, const String&) {
+            ledController.printRegisterStats(out);
+        });
+    commandInterface.addCommand("i2c", "I2C bus queue waits and bus time per device ('i2c reset' clears)",
+        [](Stream& out, const String& args) {
+            if (args == "reset") {
+                i2cBus.resetStats();
+                out.println("I2C bus stats cleared");
+                return;
+            }
+            i2cBus.printStats(out);
+        });
+    commandInterface.addCommand("power", "INA219 sampler: conversions, polls, latest reading ('power reset' clears)",
+        [](Stream& out, const String& args) {
+            if (args == "reset") {
+                powerSampler.resetStats();
+                out.println("Power sampler stats cleared");
+                return;
+            }
+            powerSampler.printStats(out);
+            heatOutput.printStats(out);
+        });
+    commandInterface.addCommand("heatout", "Heat PWM resolution and duty ('heatout dither on|off')",
+        [](Stream& out, const String& args) {
+            if (args == "dither on") {
+                heatOutput.setDithering(true);
+            } else if (args == "dither off") {
+                heatOutput.setDithering(false);
+            }
+            heatOutput.printStats(out);
+        });
+    commandInterface.addCommand("heatpi", "Power regulation ('heatpi on|off', 'heatpi kp|ki <x>', 'heatpi sim <W>')",
+        [](Stream& out, const String& args) {
+            int space = args.indexOf(' ');
+            String name = space > 0 ? args.substring(0, space) : args;
+            float value = space > 0 ? args.substring(space + 1).toFloat() : 0;
+            if (name == "on" || name == "off") {
+                setPowerRegulation(name == "on");
+            } else if (name == "kp" && space > 0) {
+                heatController.setGains(value, heatController.getKi());
+            } else if (name == "ki" && space > 0) {
+                heatController.setGains(heatController.getKp(), value);
+            } else if (name == "sim" && space > 0) {
+                // Same gains against the plant model, at the real sample period
+                PIController model(heatController.getKp(), heatController.getKi());
+                float dtS = powerSampler.getMeasuredConversionUs() * 1e-6f;
+                if (dtS <= 0) dtS = powerSampler.getConversionTimeUs() * 1e-6f;
+                out.print("Simulated step, ");
+                out.print(dtS * 1000, 1);
+                out.println(" ms per sample:");
+                printStepMetrics(out, simulateStep(model, HeatPlantModel(), value, dtS, 5.0f));
+                return;
+            }
+            out.print("Power regulation: ");
+            out.print(powerRegulation ? "on" : "off (CC23 sets duty)");
+            out.print(", kp ");
+            out.print(heatController.getKp(), 4);
+            out.print(", ki ");
+            out.println(heatController.getKi(), 4);
+            out.print("  Target ");
+            out.print(heatTargetW, 2);
+            out.print(" W, measured ");
+            out.print(averagePower, 2);
+            out.print(" W, duty ");
+            out.print(heatDuty * 100, 1);
+            out.print("%, integral ");
+            out.print(heatController.getIntegral(), 3);
+            out.println(heatController.isSaturated() ? " (saturated)" : "");
+            if (heatStep.isActive()) {
+                printStepMetrics(out, heatStep.get());
+            }
+        });
+    commandInterface.addCommand("warmup", "Boost-then-hold warm-up ('warmup on|off', 'warmup c|g <x>' pad model)",
+        [](Stream& out, const String& args) {
+            int space = args.indexOf(' ');
+            String name = space > 0 ? args.substring(0, space) : args;
+            float value = space > 0 ? args.substring(space + 1).toFloat() : 0;
+            if (name == "on" || name == "off") {
+                warmupBoostEnabled = name == "on";
+            } else if (name == "c" && value > 0) {
+                padThermal.setModel(value, padThermal.getLoss());
+            } else if (name == "g" && value > 0) {
+                padThermal.setModel(padThermal.getHeatCapacity(), value);
+            }
+            out.print("Warm-up boost: ");
+            out.print(warmupBoostEnabled ? "on" : "off");
+            out.println(warmupBoosting ? " (boosting)" : "");
+            out.print("  Pad model: C ");
+            out.print(padThermal.getHeatCapacity(), 1);
+            out.print(" J/C, G ");
+            out.print(padThermal.getLoss(), 3);
+            out.print(" W/C, time constant ");
+            out.print(padThermal.getTimeConstantS(), 0);
+            out.println(" s");
+            out.print("  Estimated rise +");
+            out.print(padThermal.getRise(), 1);
+            out.print(" C, target holds +");
+            out.print(padThermal.steadyStateRise(heatTargetW), 1);
+            out.print(" C; last boost ");
+            out.print(lastBoostMs / 1000.0, 1);
+            out.println(" s");
+        });
+    commandInterface.addCommand("trace", "CC23-to-PWM latency ('trace on|off|reset')",
+        [](Stream& out, const String& args) {
+            if (args == "on") {
+                tracer.setEnabled(true);
+            } else if (args == "off") {
+                tracer.setEnabled(false);
+            } else if (args == "reset") {
+                tracer.clear();
+                out.println("Trace cleared");
+                return;
+            }
+            tracer.printReport(out);
+        });
+    commandInterface.addCommand("envelope", "Stored heat envelopes ('envelope <n> [once]', 'envelope stop|reset')",
+        [](Stream& out, const String& args) {
+            if (args == "stop") {
+                playHeatEnvelope(0, false);
+            } else if (args == "reset") {
+                heatEnvelope.resetTimingStats();
+                out.println("Envelope stats cleared");
+                return;
+            } else if (args.length() > 0) {
+                int space = args.indexOf(' ');
+                long number = (space > 0 ? args.substring(0, space) : args).toInt();
+                bool once = space > 0 && args.substring(space + 1) == "once";
+                if (number < 1 || !playHeatEnvelope(number, !once)) {
+                    out.print("Envelope must be 1..");
+                    out.print(NUM_HEAT_ENVELOPES);
+                    out.println(" and the heat armed");
+                }
+            }
+            out.print("Heat envelope: ");
+            out.print(heatEnvelope.isPlaying() ? "playing" : "idle");
+            out.print(" (Program Change 1..");
+            out.print(NUM_HEAT_ENVELOPES);
+            out.println(" plays, 0 stops)");
+            heatEnvelope.printTimingStats(out);
+        });
+    commandInterface.addCommand("guard", "Overcurrent cutoff ('guard inject|stall|rearm|reset')",
+        [](Stream& out, const String& args) {
+            if (args == "inject") {
+                // Next conversion reads as an overcurrent
+                injectedFaultUs.store((uint32_t)esp_timer_get_time());
+                out.println("Fault injected");
+                return;
+            } else if (args == "stall") {
+                // Stop the sampler; the watchdog cuts if the pad is driven
+                powerSampler.setPaused(true);
+                out.println("INA219 sampler paused ('guard rearm' resumes)");
+                return;
+            } else if (args == "rearm") {
+                setHeatTarget(0);
+                heatSetpoint = 0;
+                currentHeatLevel = 0;
+                writeHeatDuty(0);
+                heatController.reset(0);
+                powerSampler.setPaused(false);
+                heatCutoff.rearm();
+                cutoffReported = false;
+                out.println("Heat output rearmed at 0");
+            } else if (args == "reset") {
+                heatCutoff.resetStats();
+                out.println("Guard stats cleared");
+                return;
+            }
+            SafetyCutoff::Stats stats = heatCutoff.getStats();
+            out.print("Heat cutoff: ");
+            out.print(heatCutoff.isTripped() ? "TRIPPED" : "armed");
+            out.print(", limit ");
+            out.print(OVERCURRENT_A, 2);
+            out.print(" A, sensor timeout ");
+            out.print(SENSOR_TIMEOUT_US / 1000);
+            out.println(" ms");
+            out.print("  Trips ");
+            out.print(stats.trips);
+            out.print(", last ");
+            out.print(cutoffReasonName(stats.lastReason));
+            out.print(" in ");
+            out.print(stats.lastLatencyUs);
+            out.print(" us, max ");
+            out.print(stats.maxLatencyUs);
+            out.println(" us (fault to pin low)");
+        });
     
     Serial.println("Routing configured:");
     Serial.println("  Route 1: Heat Encoder → CC23 → Bluetooth Out (transmission)");
@@ -197,17 +752,49 @@ void setup() {
 void loop() {
     // Update all MIDI processing and routing
     Control_Surface.loop();
+    blePacker.update();
     delay(5); // Limit control surface processing.
 
-    // Read INA219 sensor periodically
-    unsigned long currentTime = millis();
-    if (currentTime - lastINA219Reading >= INA219_INTERVAL) {
-        lastINA219Reading = currentTime;
-        
-        // Get averaged readings (multiple samples for stability)
-        AveragedReadings readings = getAveragedReadings(10);
+    // Power limiting on every new INA219 snapshot (never blocks on the sensor)
+    PowerSnapshot readings;
+    if (heatCutoff.isTripped() && !cutoffReported) {
+        // The pin is already low; bring the controller state in line
+        cutoffReported = true;
+        playHeatEnvelope(0, false);
+        setHeatTarget(0);
+        writeHeatDuty(0);
+        heatController.reset(0);
+        currentHeatLevel = 0;
+        SafetyCutoff::Stats stats = heatCutoff.getStats();
+        Serial.print("HEAT CUT OFF: ");
+        Serial.print(cutoffReasonName(stats.lastReason));
+        Serial.print(", ");
+        Serial.print(stats.lastLatencyUs);
+        Serial.println(" us to pin low ('guard rearm' to restore)");
+    }
+    
+    if (envelopeTargetPending.exchange(false)) {
+        setHeatTarget(envelopeTargetW.load(), false);
+    }
+    
+    while (powerSampler.pop(readings)) {
         averagePower = readings.power_W;
         
+        float dtS = (readings.timeUs - lastSnapshotUs) * 1e-6f;
+        lastSnapshotUs = readings.timeUs;
+        if (dtS > MAX_REGULATION_DT_S) {
+            dtS = MAX_REGULATION_DT_S;
+        }
+        padThermal.update(readings.power_W, dtS);
+        
+        if (powerRegulation) {
+            regulateHeat(readings, dtS);  // Following an envelope or CC23
+            continue;
+        }
+        if (heatEnvelope.isPlaying()) {
+            continue;  // Open loop: the envelope owns the PWM
+        }
+        
         // Power limiting logic: if we exceed 8W, set current heat level as maximum
         if (averagePower > MAX_POWER_W && currentHeatLevel > 0) {
             maxAllowedHeatLevel = currentHeatLevel;
@@ -217,6 +804,16 @@ void loop() {
             Serial.print((maxAllowedHeatLevel * 100) / 127);
             Serial.println("%)");
         }
+    }
+    
+    unsigned long currentTime = millis();
+    if (currentTime - lastPwmSync >= PWM_SYNC_INTERVAL) {
+        lastPwmSync = currentTime;
+        syncHeatPwmToSampler();
+    }
+    
+    if (currentTime - lastINA219Log >= INA219_LOG_INTERVAL && powerSampler.latest(readings)) {
+        lastINA219Log = currentTime;
         
         // Print averaged readings in a clear format
         Serial.print("INA219 - Current: ");
@@ -225,18 +822,37 @@ void loop() {
         Serial.print(readings.voltage_V, 2);
         Serial.print(" V, Power: ");
         Serial.print(readings.power_W, 3);
-        Serial.print(" W (all avg)");
+        Serial.print(" W (hw avg)");
         
-        // Add heat level and limit context
-        Serial.print(" (Heat: ");
-        Serial.print((currentHeatLevel * 100) / 127);
-        Serial.print("%, Max: ");
-        Serial.print((maxAllowedHeatLevel * 100) / 127);
-        Serial.print("%");
-        if (powerLimitActive) {
-            Serial.print(" POWER LIMITED");
+        if (powerRegulation) {
+            Serial.print(" (Target: ");
+            Serial.print(heatTargetW, 2);
+            if (warmupBoosting) {
+                Serial.print(" W BOOST");
+            } else {
+                Serial.print(" W");
+            }
+            Serial.print(", pad +");
+            Serial.print(padThermal.getRise(), 1);
+            Serial.print(" C, duty: ");
+            Serial.print(heatDuty * 100, 1);
+            Serial.print("%");
+            if (heatController.isSaturated()) {
+                Serial.print(" SATURATED");
+            }
+            Serial.println(")");
+        } else {
+            // Add heat level and limit context
+            Serial.print(" (Heat: ");
+            Serial.print((currentHeatLevel * 100) / 127);
+            Serial.print("%, Max: ");
+            Serial.print((maxAllowedHeatLevel * 100) / 127);
+            Serial.print("%");
+            if (powerLimitActive) {
+                Serial.print(" POWER LIMITED");
+            }
+            Serial.println(")");
         }
-        Serial.println(")");
     }
 
     // Update LED display to show current heat level as gradient line segment
@@ -4,6 +4,10 @@
 #include "cli.h"
 #include "encoder.h"
 #include "ledcontrol.h"
+#include "i2cbus.h"
+#include "fsrinput.h"
+#include "trace.h"
+#include "blemidipacker.h"
 
 // MIDI Interface
 BluetoothMIDI_Interface midibt;
@@ -17,33 +21,72 @@ CLI commandInterface(Serial, midibt);
 // Encoder and LED Controller
 EffectEncoder effectEncoder;
 LEDController ledController;
+bool detentClick = false;  // One-shot click on each encoder detent (CLI `click`)
 
-// FSR Input Element
-CCPotentiometer fsr {
+// FSR Input Element (continuous ADC, one CC per significant change)
+FSRInput fsr {
     A0,     // Analog pin
     {0x16}, // CC 22 (0x16 in hex)
 };
 
+// Live modulation of synth effects (CONST_VIBE), 64 = as designed
+const uint8_t CC_SYNTH_RATE = 26;
+const uint8_t CC_SYNTH_DEPTH = 27;
+
 /**
  * @brief Custom MIDI sink for haptic volume control
  * 
  * This sink receives MIDI messages from pipes and controls the haptic player
- * based on CC 22 messages. It follows the TrueMIDI_Sink interface properly.
+ * based on CC 22 messages, plus synth rate/depth on CC 26/27. It follows the
+ * TrueMIDI_Sink interface properly.
+ * 
+ * The sink fed by Bluetooth passes the BLE-MIDI timestamp of each message
+ * along, so the player can smooth out connection-interval bursts in its
+ * jitter buffer (CLI `jitter`, off at boot).
+ * 
+ * In touch-through mode the FSR drives the volume directly, so the local
+ * sink ignores the FSR's own CC22.
  */
 class HapticVolumeSink : public TrueMIDI_Sink {
 public:
-    explicit HapticVolumeSink(HapticPlayer& player) : haptic(player) {}
+    explicit HapticVolumeSink(HapticPlayer& player, BluetoothMIDI_Interface* bleSource = nullptr)
+        : haptic(player), ble(bleSource) {}
     
     void sinkMIDIfromPipe(ChannelMessage msg) override {
+        if (msg.getMessageType() != MIDIMessageType::ControlChange) {
+            return;
+        }
+
+        HapticParam param;
+        if (msg.getData1() == 22) {
+            if (ble == nullptr && haptic.isTouchThrough()) {
+                return;  // Already applied from the FSR reading
+            }
+            param = HapticParam::Volume;
+        } else if (msg.getData1() == CC_SYNTH_RATE) {
+            param = HapticParam::SynthRate;
+        } else if (msg.getData1() == CC_SYNTH_DEPTH) {
+            param = HapticParam::SynthDepth;
+        } else {
+            return;
+        }
+
+        TracePath trace = TracePath::None;
+        if (param == HapticParam::Volume) {
+            trace = ble == nullptr ? TracePath::FsrMidi : TracePath::BleCC22;
+            tracer.stamp(trace, TraceStage::Sink);
+        }
+
+        if (ble == nullptr) {
+            haptic.setParam(param, msg.getData2(), trace);
+        } else if (haptic.scheduleParam(param, msg.getData2(), ble->getTimestamp(), trace)) {
+            return;  // Buffered, applied later by the haptic task
+        }
+
         // Handle CC 22 messages for haptic volume control
-        if (msg.getMessageType() == MIDIMessageType::ControlChange && 
-            msg.getData1() == 22) {
-            
-            float volume = msg.getData2() / 127.0f;
-            haptic.setVolume(volume);
-            
+        if (param == HapticParam::Volume) {
             Serial.print("Haptic volume: ");
-            Serial.print(volume, 3);
+            Serial.print(haptic.getVolume(), 3);
             Serial.print(" (CC22=");
             Serial.print(msg.getData2());
             Serial.println(")");
@@ -57,10 +100,12 @@ public:
 
 private:
     HapticPlayer& haptic;
+    BluetoothMIDI_Interface* ble;
 };
 
-// Instantiate the haptic sink
+// Instantiate the haptic sinks: local FSR and Bluetooth (timestamped)
 HapticVolumeSink hapticSink(hapticPlayer);
+HapticVolumeSink bleHapticSink(hapticPlayer, &midibt);
 
 /**
  * @brief MIDI Routing Setup
@@ -83,29 +128,41 @@ HapticVolumeSink hapticSink(hapticPlayer);
  *                         │ Control_     │
  *                         │ Surface      │
  *                         └──────────────┘
+ * 
+ * In touch-through mode (default, CLI `touch`) the sink ignores CC22 on
+ * Route 1: the haptic task reads the FSR directly every tick through a
+ * TouchChannel, bypassing the pipes and the loop delay.
  */
 
-// Pipe factory for proper routing management (need 3 pipes for separation of concerns)
-MIDI_PipeFactory<3> pipeFactory;
+// Transmit packer: one BLE-MIDI packet per connection interval (Route 2; Routes 1 and 3 use tracing pipes)
+BLEMIDIPacker blePacker {midibt};
+
+// CC22 latency stamps as messages leave Control_Surface / arrive over Bluetooth (CLI `trace`)
+TracingPipe fsrTracePipe {22, TracePath::FsrMidi, TraceStage::Dispatch};
+TracingPipe bleTracePipe {22, TracePath::BleCC22, TraceStage::Input};
 
 void setup() {
     Serial.begin(115200);
     Serial.println("=== Clean MIDI Haptic Controller ===");
     
+    // Shared I2C bus (LED ring, DRV2605L); haptic writes get top priority
+    i2cBus.begin();
+    
     // Set up clean pipe-based routing BEFORE Control_Surface.begin()
     // Three explicit, unidirectional routes for clear separation of concerns:
     // 
-    // Route 1: Control_Surface (FSR) → HapticSink (standalone haptic control)
-    Control_Surface >> pipeFactory >> hapticSink;
+    // Route 1: Control_Surface (FSR) → HapticSink (standalone haptic control, unless touch-through)
+    Control_Surface >> fsrTracePipe >> hapticSink;
     
     // Route 2: Control_Surface (FSR) → Bluetooth (FSR data transmission)
-    Control_Surface >> pipeFactory >> midibt;
+    Control_Surface >> blePacker >> midibt;
     
     // Route 3: Bluetooth → HapticSink (external MIDI control of haptics)
-    midibt >> pipeFactory >> hapticSink;
+    midibt >> bleTracePipe >> bleHapticSink;
     
     // Set Bluetooth device name
     midibt.setName("VIBE bit 2 USR");
+    blePacker.begin();
     
     // Initialize LED controller
     ledController.begin();
@@ -128,28 +185,141 @@ void setup() {
             
     // Initialize haptic system
     hapticPlayer.setVolume(0.0f);
-    hapticPlayer.setEffect(std::make_shared<HapticEffect>(EFFECT_CONST_VIBE));
-    hapticPlayer.start();
+    hapticPlayer.setEffect(&EFFECT_CONST_VIBE);
+    hapticPlayer.setTouchThrough(&fsr.touchChannel());
+    hapticPlayer.start(PlaybackMode::Timer);
     
     // Initialize CLI
     commandInterface.begin();
+    commandInterface.addCommand("blemidi", "Bluetooth MIDI packing: packets/s, messages per packet, queueing ('blemidi interval <ms>|reset')",
+        [](Stream& out, const String& args) {
+            if (args.startsWith("interval")) {
+                long ms = args.substring(8).toInt();
+                if (ms > 0) {
+                    blePacker.setInterval(ms);
+                }
+            } else if (args == "reset") {
+                blePacker.resetStats();
+                out.println("BLE MIDI stats cleared");
+                return;
+            }
+            blePacker.printStats(out);
+        });
+    commandInterface.addCommand("timing", "Haptic step lateness stats ('timing reset' clears)",
+        [](Stream& out, const String& args) {
+            if (args == "reset") {
+                hapticPlayer.resetTimingStats();
+                out.println("Haptic timing stats cleared");
+                return;
+            }
+            hapticPlayer.printTimingStats(out);
+        });
+    commandInterface.addCommand("jitter", "BLE-MIDI jitter buffer stats ('jitter on|off|<ms>' sets latency, 'jitter reset')",
+        [](Stream& out, const String& args) {
+            if (args == "reset") {
+                hapticPlayer.resetJitterStats();
+                out.println("Jitter buffer stats cleared");
+                return;
+            }
+            if (args == "on") {
+                hapticPlayer.setJitterLatency(JitterBuffer::DEFAULT_LATENCY_MS);
+            } else if (args == "off") {
+                hapticPlayer.setJitterLatency(0);
+            } else if (args.length() > 0) {
+                hapticPlayer.setJitterLatency(args.toInt());
+            }
+            hapticPlayer.printJitterStats(out);
+        });
+    commandInterface.addCommand("regs", "Register cache hits: writes issued vs suppressed",
+        [](Stream& out, const String&) {
+            ledController.printRegisterStats(out);
+            hapticPlayer.printRegisterStats(out);
+        });
+    commandInterface.addCommand("i2c", "I2C bus queue waits and bus time per device ('i2c reset' clears)",
+        [](Stream& out, const String& args) {
+            if (args == "reset") {
+                i2cBus.resetStats();
+                out.println("I2C bus stats cleared");
+                return;
+            }
+            i2cBus.printStats(out);
+        });
+    commandInterface.addCommand("touch", "FSR-to-haptic latency ('touch on|off' switches touch-through)",
+        [](Stream& out, const String& args) {
+            if (args == "on") {
+                hapticPlayer.setTouchThrough(&fsr.touchChannel());
+            } else if (args == "off") {
+                hapticPlayer.setTouchThrough(nullptr);
+            }
+            hapticPlayer.printTouchStats(out);
+        });
+    commandInterface.addCommand("click", "One-shot click on encoder detents ('click on|off')",
+        [](Stream& out, const String& args) {
+            if (args == "on" || args == "off") {
+                detentClick = args == "on";
+            }
+            out.print("Detent click: ");
+            out.println(detentClick ? "on (mixed over the effect)" : "off");
+        });
+    commandInterface.addCommand("trace", "Input-to-actuator latency per path ('trace on|off|reset')",
+        [](Stream& out, const String& args) {
+            if (args == "on") {
+                tracer.setEnabled(true);
+            } else if (args == "off") {
+                tracer.setEnabled(false);
+            } else if (args == "reset") {
+                tracer.clear();
+                out.println("Trace cleared");
+                return;
+            }
+            tracer.printReport(out);
+        });
+    commandInterface.addCommand("fsr", "FSR acquisition stats ('fsr ema|hyst|rate <n>' tunes the filter)",
+        [](Stream& out, const String& args) {
+            int space = args.indexOf(' ');
+            if (space > 0) {
+                String name = args.substring(0, space);
+                int value = args.substring(space + 1).toInt();
+                if (name == "ema") {
+                    fsr.config().emaShift = constrain(value, 0, 8);
+                } else if (name == "hyst") {
+                    fsr.config().hysteresis = constrain(value, 0, 1024);
+                } else if (name == "rate") {
+                    fsr.config().minIntervalMs = constrain(value, 0, 1000);
+                } else {
+                    out.println("Usage: fsr [ema <0-8> | hyst <0-1024> | rate <ms>]");
+                    return;
+                }
+            }
+            fsr.printStats(out);
+        });
+    commandInterface.addCommand("mixbench", "Measure haptic mixer cost per tick for 1-4 voices",
+        [](Stream& out, const String&) {
+            hapticPlayer.printMixerBenchmark(out);
+        });
     
     Serial.println("Routing configured:");
-    Serial.println("  Route 1: FSR (A0) → CC22 → Haptic Volume (standalone)");
-    Serial.println("  Route 2: FSR (A0) → CC22 → Bluetooth Out (transmission)");
+    Serial.println("  Route 1: FSR (A0) → Haptic Volume (touch-through, every haptic tick)");
+    Serial.println("  Route 2: FSR (A0) → CC22 → Bluetooth Out (rate limited)");
     Serial.println("  Route 3: Bluetooth In → CC22 → Haptic Volume (external control)");
+    Serial.println("  Route 3: Bluetooth In → CC26/27 → Synth Rate/Depth (external control)");
+    Serial.println("  Route 3 jitter buffer: off ('jitter on' or 'jitter <ms>' to enable)");
     Serial.println("Ready!");
 }
 
 void loop() {
     // Update all MIDI processing and routing
     Control_Surface.loop();
+    blePacker.update();
     delay(5); // Limit control surface processing.
 
     // Handle encoder for effect switching
     int newEffect = effectEncoder.update();
     if (newEffect >= 0) {
         hapticPlayer.setEffect(effectEncoder.getEffect(newEffect));
+        if (detentClick) {
+            hapticPlayer.playOneShot(&EFFECT_CLICK);  // Detent feedback on top of the new effect
+        }
         ledController.updateDisplay(newEffect);
     }
     
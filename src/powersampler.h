@@ -0,0 +1,427 @@
+#pragma once
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+#include "i2cbus.h"
+
+/**
+ * @brief One coherent INA219 measurement (all values from the same conversion)
+ */
+struct PowerSnapshot {
+    uint32_t sequence;   // Conversion number, increments by one per snapshot
+    uint32_t timeUs;     // esp_timer time the conversion was read (low 32 bits)
+    float current_A;
+    float voltage_V;     // Bus voltage
+    float power_W;
+    float shunt_mV;
+    bool overflow;       // Math overflow: current/power out of range
+};
+
+/**
+ * @brief INA219 sampler task with hardware averaging
+ *
+ * The INA219 runs in continuous mode and averages many ADC samples per
+ * conversion itself (SADC/BADC fields of the config register), so there
+ * is no software averaging and no delay() in the main loop. The task
+ * sleeps for most of a conversion, polls the conversion-ready flag (CNVR)
+ * in the bus voltage register, then reads shunt, current and power.
+ * Reading the power register clears CNVR.
+ *
+ * Snapshots go into a lock-free ring: the task writes each slot and
+ * publishes it with a commit counter, the main loop drains it with pop()
+ * or takes the newest with latest(). The writer never waits; if the reader
+ * falls a whole ring behind, the missed snapshots are counted.
+ *
+ * The chip's ADC runs on its own oscillator, so the nominal conversion
+ * times of the datasheet are only typical. getMeasuredConversionUs() is
+ * the real period, timed over all conversions since begin(); use it to
+ * lock a PWM to the ADC (see getSampleWindowUs()).
+ *
+ * The INA219 is accessed with raw register transactions through i2cBus;
+ * calibration is set for the 0.1 ohm shunt on the Adafruit breakout
+ * (current LSB 0.1 mA, power LSB 2 mW).
+ */
+class PowerSampler {
+public:
+    static constexpr uint8_t RING_SIZE = 16;
+    static constexpr uint32_t MIN_TIMED_CONVERSIONS = 50;  // ~1 s before the period is trusted
+    static constexpr uint8_t DEFAULT_ADDRESS = 0x40;
+
+    // ADC setting of the config register: 12-bit, 2^n samples averaged (0..7)
+    static constexpr uint8_t ADC_SAMPLES_1 = 0x8;
+    static constexpr uint8_t ADC_SAMPLES_8 = 0xB;
+    static constexpr uint8_t ADC_SAMPLES_32 = 0xD;
+    static constexpr uint8_t ADC_SAMPLES_128 = 0xF;
+
+    /**
+     * @brief Called on the sampler task with every conversion, before it is published
+     *
+     * For protection checks that must not depend on the main loop.
+     */
+    typedef void (*Guard)(const PowerSnapshot& snapshot, void* arg);
+
+    struct Stats {
+        uint32_t snapshots;
+        uint32_t readErrors;
+        uint32_t notReadyPolls;   // CNVR polls that found no new conversion
+        uint32_t missed;          // Snapshots overwritten before pop()
+        uint32_t maxIntervalUs;   // Longest time between snapshots
+    };
+
+    explicit PowerSampler(uint8_t address = DEFAULT_ADDRESS) : address(address) {}
+
+    /**
+     * @brief Configure the INA219 and start the sampler task
+     *
+     * @param shuntAdc ADC setting for the shunt (current) conversion
+     * @param busAdc ADC setting for the bus voltage conversion
+     * @return false if the INA219 does not respond
+     */
+    bool begin(uint8_t shuntAdc = ADC_SAMPLES_32, uint8_t busAdc = ADC_SAMPLES_8,
+               UBaseType_t priority = 3, BaseType_t core = 0) {
+        if (!i2cBus.probe(address)) {
+            return false;
+        }
+        shuntSetting = shuntAdc;
+        busSetting = busAdc;
+
+        writeRegister(REG_CONFIG, CONFIG_RESET);
+        writeRegister(REG_CALIBRATION, CALIBRATION);
+        if (writeRegister(REG_CONFIG, configValue()) != 0) {
+            return false;
+        }
+
+        if (task == nullptr) {
+            xTaskCreatePinnedToCore(taskLoop, "PowerSampler", 3072, this, priority, &task, core);
+        }
+        return true;
+    }
+
+    void setGuard(Guard guard, void* arg) {
+        guardArg = arg;
+        guardFn.store(guard, std::memory_order_release);
+    }
+
+    /**
+     * @brief esp_timer time of the last conversion read (ISR safe)
+     */
+    uint32_t getLastSnapshotUs() const {
+        return lastSnapshotUs.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Stop and restart sampling (fault injection for watchdog tests)
+     */
+    void setPaused(bool paused) {
+        if (task == nullptr) return;
+        if (paused) {
+            vTaskSuspend(task);
+        } else {
+            retime = true;  // Conversions were missed while suspended
+            vTaskResume(task);
+        }
+    }
+
+    /**
+     * @brief Duration of one shunt + bus conversion with the current averaging
+     */
+    uint32_t getConversionTimeUs() const {
+        return adcTimeUs(shuntSetting) + adcTimeUs(busSetting);
+    }
+
+    /**
+     * @brief Conversion period measured from the CNVR timing
+     *
+     * Timed over unbroken runs of conversions: a gap (read error, pause,
+     * starved task) starts a new run and the last result is kept until
+     * the new run is MIN_TIMED_CONVERSIONS long.
+     *
+     * @return 0 until MIN_TIMED_CONVERSIONS conversions were seen
+     */
+    float getMeasuredConversionUs() const {
+        return measuredConversionUs;
+    }
+
+    /**
+     * @brief Integration time of one ADC sample, measured
+     *
+     * Shunt and bus samples take the same time; the INA219 integrates the
+     * input over each one. A PWM whose period divides this window is
+     * averaged over whole periods in every sample, whatever the phase.
+     *
+     * @return 0 until the conversion period is known
+     */
+    float getSampleWindowUs() const {
+        return getMeasuredConversionUs() / (samplesPerSetting(shuntSetting) + samplesPerSetting(busSetting));
+    }
+
+    /**
+     * @brief Take the next unread snapshot (single consumer)
+     *
+     * @return false if there is nothing new
+     */
+    bool pop(PowerSnapshot& out) {
+        uint32_t end = writeIndex.load(std::memory_order_acquire);
+        if (end - readIndex > RING_SIZE) {
+            missedCount += end - readIndex - RING_SIZE;
+            readIndex = end - RING_SIZE;
+        }
+        while (readIndex != end) {
+            uint32_t index = readIndex++;
+            if (readSlot(index, out)) {
+                return true;
+            }
+            missedCount++;  // Overwritten while reading
+        }
+        return false;
+    }
+
+    /**
+     * @brief Newest snapshot, without consuming anything
+     *
+     * @return false if there is none yet
+     */
+    bool latest(PowerSnapshot& out) const {
+        uint32_t end = writeIndex.load(std::memory_order_acquire);
+        return end != 0 && readSlot(end - 1, out);
+    }
+
+    Stats getStats() const {
+        Stats s;
+        s.snapshots = snapshots;
+        s.readErrors = readErrors;
+        s.notReadyPolls = notReadyPolls;
+        s.missed = missedCount;
+        s.maxIntervalUs = maxIntervalUs;
+        return s;
+    }
+
+    void resetStats() {
+        snapshots = 0;
+        readErrors = 0;
+        notReadyPolls = 0;
+        missedCount = 0;
+        maxIntervalUs = 0;
+    }
+
+    void printStats(Stream& out) const {
+        Stats s = getStats();
+        out.print("INA219 sampler: conversion ");
+        out.print(getConversionTimeUs());
+        out.print(" us (shunt ");
+        out.print(samplesPerSetting(shuntSetting));
+        out.print(" samples, bus ");
+        out.print(samplesPerSetting(busSetting));
+        out.println(" samples averaged)");
+        out.print("  Snapshots: ");
+        out.print(s.snapshots);
+        out.print(", read errors: ");
+        out.print(s.readErrors);
+        out.print(", not-ready polls: ");
+        out.print(s.notReadyPolls);
+        out.print(", missed by reader: ");
+        out.println(s.missed);
+        out.print("  Max interval: ");
+        out.print(s.maxIntervalUs);
+        out.print(" us, measured conversion: ");
+        out.print(getMeasuredConversionUs(), 1);
+        out.print(" us, sample window: ");
+        out.print(getSampleWindowUs(), 2);
+        out.println(" us");
+        PowerSnapshot snapshot;
+        if (latest(snapshot)) {
+            out.print("  Latest: ");
+            out.print(snapshot.current_A, 3);
+            out.print(" A, ");
+            out.print(snapshot.voltage_V, 2);
+            out.print(" V, ");
+            out.print(snapshot.power_W, 3);
+            out.print(" W");
+            if (snapshot.overflow) out.print(" (OVERFLOW)");
+            out.println();
+        }
+    }
+
+private:
+    static constexpr uint8_t REG_CONFIG = 0x00;
+    static constexpr uint8_t REG_SHUNT = 0x01;
+    static constexpr uint8_t REG_BUS = 0x02;
+    static constexpr uint8_t REG_POWER = 0x03;
+    static constexpr uint8_t REG_CURRENT = 0x04;
+    static constexpr uint8_t REG_CALIBRATION = 0x05;
+
+    static constexpr uint16_t CONFIG_RESET = 0x8000;
+    static constexpr uint16_t CONFIG_32V_320MV = 0x2000 | 0x1800;  // BRNG 32 V, PGA /8
+    static constexpr uint16_t MODE_CONTINUOUS = 0x7;                // Shunt and bus, continuous
+    static constexpr uint16_t BUS_CNVR = 0x0002;
+    static constexpr uint16_t BUS_OVF = 0x0001;
+
+    static constexpr uint16_t CALIBRATION = 4096;      // 0.04096 / (0.1 mA * 0.1 ohm)
+    static constexpr float CURRENT_LSB_A = 0.0001f;
+    static constexpr float POWER_LSB_W = 0.002f;        // 20 * current LSB
+    static constexpr float BUS_LSB_V = 0.004f;
+    static constexpr float SHUNT_LSB_MV = 0.01f;
+
+    struct Slot {
+        std::atomic<uint32_t> commit{0};  // Write index + 1 once complete, 0 while writing
+        PowerSnapshot snapshot;
+    };
+
+    uint8_t address;
+    uint8_t shuntSetting = ADC_SAMPLES_32;
+    uint8_t busSetting = ADC_SAMPLES_8;
+    TaskHandle_t task = nullptr;
+
+    Slot slots[RING_SIZE];
+    std::atomic<uint32_t> writeIndex{0};
+    uint32_t readIndex = 0;               // Consumer only
+
+    volatile uint32_t snapshots = 0;
+    volatile uint32_t readErrors = 0;
+    volatile uint32_t notReadyPolls = 0;
+    volatile uint32_t missedCount = 0;
+    volatile uint32_t maxIntervalUs = 0;
+    volatile float measuredConversionUs = 0;
+    volatile bool retime = false;
+    std::atomic<uint32_t> lastSnapshotUs{0};
+    std::atomic<Guard> guardFn{nullptr};
+    void* guardArg = nullptr;
+
+    uint16_t configValue() const {
+        return CONFIG_32V_320MV | ((uint16_t)busSetting << 7) | ((uint16_t)shuntSetting << 3) | MODE_CONTINUOUS;
+    }
+
+    static uint8_t samplesPerSetting(uint8_t setting) {
+        return (setting & 0x8) ? 1 << (setting & 0x7) : 1;
+    }
+
+    /**
+     * @brief Conversion time of one ADC setting (datasheet table 5)
+     */
+    static uint32_t adcTimeUs(uint8_t setting) {
+        if (setting & 0x8) {
+            return 532UL << (setting & 0x7);  // 532 us per averaged sample
+        }
+        static const uint16_t single[4] = {84, 148, 276, 532};  // 9..12-bit, one sample
+        return single[setting & 0x3];
+    }
+
+    uint8_t writeRegister(uint8_t reg, uint16_t value) {
+        uint8_t data[2] = {(uint8_t)(value >> 8), (uint8_t)(value & 0xFF)};
+        return i2cBus.write(address, reg, data, 2);
+    }
+
+    bool readRegister(uint8_t reg, uint16_t& value) {
+        uint8_t data[2];
+        if (i2cBus.read(address, reg, data, 2) != 0) {
+            readErrors++;
+            return false;
+        }
+        value = ((uint16_t)data[0] << 8) | data[1];
+        return true;
+    }
+
+    bool readSlot(uint32_t index, PowerSnapshot& out) const {
+        const Slot& slot = slots[index % RING_SIZE];
+        if (slot.commit.load(std::memory_order_acquire) != index + 1) {
+            return false;
+        }
+        out = slot.snapshot;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot.commit.load(std::memory_order_relaxed) == index + 1;
+    }
+
+    void publish(const PowerSnapshot& snapshot) {
+        uint32_t index = writeIndex.load(std::memory_order_relaxed);
+        Slot& slot = slots[index % RING_SIZE];
+        slot.commit.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.snapshot = snapshot;
+        slot.commit.store(index + 1, std::memory_order_release);
+        writeIndex.store(index + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Wait for CNVR and read one conversion
+     */
+    bool readConversion(PowerSnapshot& out) {
+        uint16_t bus;
+        while (true) {
+            if (!readRegister(REG_BUS, bus)) return false;
+            if (bus & BUS_CNVR) break;
+            notReadyPolls++;
+            vTaskDelay(1);
+        }
+
+        uint16_t shunt, current, power;
+        // Power last: reading it clears CNVR for the next conversion
+        if (!readRegister(REG_SHUNT, shunt) || !readRegister(REG_CURRENT, current) ||
+            !readRegister(REG_POWER, power)) {
+            return false;
+        }
+
+        out.timeUs = (uint32_t)esp_timer_get_time();
+        out.voltage_V = (bus >> 3) * BUS_LSB_V;
+        out.shunt_mV = (int16_t)shunt * SHUNT_LSB_MV;
+        out.current_A = (int16_t)current * CURRENT_LSB_A;
+        out.power_W = power * POWER_LSB_W;
+        out.overflow = bus & BUS_OVF;
+        return true;
+    }
+
+    static void taskLoop(void* param) {
+        auto self = static_cast<PowerSampler*>(param);
+        uint32_t sequence = 0;
+        uint32_t lastTimeUs = 0;
+        int64_t runStartUs = 0;       // First conversion of the current unbroken run
+        int64_t lastReadyUs = 0;
+        uint32_t runConversions = 0;  // Conversions since runStartUs
+
+        while (true) {
+            // Sleep through most of the conversion, then poll CNVR
+            uint32_t sleepMs = self->getConversionTimeUs() / 1000;
+            if (sleepMs > 1) {
+                vTaskDelay(pdMS_TO_TICKS(sleepMs - 1));
+            }
+
+            PowerSnapshot snapshot;
+            if (!self->readConversion(snapshot)) {
+                self->retime = true;
+                vTaskDelay(pdMS_TO_TICKS(10));
+                continue;
+            }
+            snapshot.sequence = sequence++;
+            self->lastSnapshotUs.store(snapshot.timeUs, std::memory_order_relaxed);
+
+            Guard guard = self->guardFn.load(std::memory_order_acquire);
+            if (guard != nullptr) {
+                guard(snapshot, self->guardArg);
+            }
+
+            // Time conversions over an unbroken run: CNVR polling is only
+            // accurate to a tick, but that error does not accumulate. A gap
+            // of more than 1.5 conversions means some were never read, so
+            // dividing by the count read would overstate the period.
+            int64_t nowUs = esp_timer_get_time();
+            bool gap = nowUs - lastReadyUs > (int64_t)self->getConversionTimeUs() * 3 / 2;
+            if (snapshot.sequence == 0 || gap || self->retime) {
+                self->retime = false;
+                runStartUs = nowUs;
+                runConversions = 0;
+            } else if (++runConversions >= MIN_TIMED_CONVERSIONS) {
+                self->measuredConversionUs = (float)(nowUs - runStartUs) / runConversions;
+            }
+            lastReadyUs = nowUs;
+
+            if (self->snapshots > 0) {
+                uint32_t interval = snapshot.timeUs - lastTimeUs;
+                if (interval > self->maxIntervalUs) self->maxIntervalUs = interval;
+            }
+            lastTimeUs = snapshot.timeUs;
+            self->snapshots++;
+            self->publish(snapshot);
+        }
+    }
+};
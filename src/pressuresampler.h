@@ -0,0 +1,429 @@
+#pragma once
+#include <Arduino.h>
+#include <esp_attr.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <atomic>
+#include "i2cbus.h"
+
+/**
+ * @brief One LPS28 pressure sample out of the FIFO
+ */
+struct PressureSample {
+    uint32_t sequence;     // Sample number, increments by one per sample
+    uint32_t timeUs;       // esp_timer time of the sample, reconstructed from the ODR
+    float pressureHPa;
+    float temperatureC;    // Read once per burst, shared by its samples
+};
+
+/**
+ * @brief LPS28 sampler task with FIFO burst reads
+ *
+ * The LPS28 runs continuously at the chosen ODR with its FIFO in
+ * continuous (stream) mode. When the FIFO reaches the watermark it raises
+ * INT; the ISR wakes the task, which reads the fill level and then every
+ * stored sample with burst reads of the FIFO output register (the
+ * address wraps within the 3-byte sample, so one read returns several
+ * samples). One wake-up per watermark instead of a status poll per loop.
+ *
+ * Without an INT pin, or if an edge is missed, the task polls the FIFO
+ * once per watermark period instead, so samples keep coming either way;
+ * getStats() shows which path delivered them.
+ *
+ * Samples go into a lock-free ring like PowerSampler's: pop() drains it
+ * from one consumer, latest() peeks at the newest.
+ *
+ * The sensor is in full-scale mode (up to 4060 hPa) and accessed with raw
+ * register transactions through i2cBus. The task waits on a semaphore,
+ * not its notification, because the blocking i2cBus calls use that.
+ */
+class PressureSampler {
+public:
+    static constexpr uint8_t RING_SIZE = 64;
+    static constexpr uint8_t DEFAULT_ADDRESS = 0x5C;
+    static constexpr uint8_t FIFO_DEPTH = 128;
+    static constexpr uint8_t MAX_WATERMARK = 64;
+
+    // Per-sample averaging (CTRL_REG1 AVG); more averaging limits the usable ODR
+    static constexpr uint8_t AVG_4 = 0;
+    static constexpr uint8_t AVG_8 = 1;
+    static constexpr uint8_t AVG_16 = 2;
+    static constexpr uint8_t AVG_32 = 3;
+
+    struct Stats {
+        uint32_t samples;
+        uint32_t bursts;          // FIFO drains
+        uint32_t interrupts;      // Drains started by INT
+        uint32_t polls;           // Drains started by the fallback timeout
+        uint32_t readErrors;
+        uint32_t fifoOverruns;    // Samples lost in the sensor
+        uint32_t missed;          // Samples overwritten before pop()
+        uint8_t maxBurst;         // Most samples in one drain
+    };
+
+    /**
+     * @param intPin GPIO wired to the LPS28 INT pin, -1 to poll the FIFO
+     */
+    explicit PressureSampler(uint8_t address = DEFAULT_ADDRESS, int8_t intPin = -1)
+        : address(address), intPin(intPin) {}
+
+    /**
+     * @brief Configure the LPS28 and start the sampler task
+     *
+     * @param odrHz Output data rate, one of 1, 4, 10, 25, 50, 75, 100, 200
+     * @param watermark Samples per burst (1..MAX_WATERMARK); latency is watermark / ODR
+     * @return false if the LPS28 does not respond
+     */
+    bool begin(uint16_t odrHz = 100, uint8_t watermark = 4, uint8_t averaging = AVG_16,
+               UBaseType_t priority = 3, BaseType_t core = 0) {
+        uint8_t id = 0;
+        if (!i2cBus.probe(address) || i2cBus.read(address, REG_WHO_AM_I, &id, 1) != 0 || id != WHO_AM_I) {
+            return false;
+        }
+        uint8_t odrCode = odrToCode(odrHz);
+        if (odrCode == 0) {
+            return false;
+        }
+        this->averaging = averaging & 0x7;
+
+        i2cBus.write(address, REG_CTRL2, CTRL2_SWRESET);
+        delay(2);
+        i2cBus.write(address, REG_CTRL2, CTRL2_FS_MODE | CTRL2_BDU);
+        i2cBus.write(address, REG_FIFO_CTRL, FIFO_BYPASS);  // Clears the FIFO
+        setWatermark(watermark);
+        i2cBus.write(address, REG_FIFO_CTRL, FIFO_CONTINUOUS);
+        if (intPin >= 0) {
+            i2cBus.write(address, REG_CTRL4, CTRL4_INT_EN | CTRL4_FIFO_WTM);
+        }
+        if (!setDataRate(odrHz)) {
+            return false;
+        }
+
+        if (task == nullptr) {
+            dataReady = xSemaphoreCreateBinary();
+            xTaskCreatePinnedToCore(taskLoop, "PressureSampler", 3072, this, priority, &task, core);
+            if (intPin >= 0) {
+                pinMode(intPin, INPUT);
+                attachInterruptArg(digitalPinToInterrupt(intPin), onInterrupt, this, RISING);
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @return false for an ODR the sensor does not have
+     */
+    bool setDataRate(uint16_t hz) {
+        uint8_t code = odrToCode(hz);
+        if (code == 0 || i2cBus.write(address, REG_CTRL1, (uint8_t)(code << 3 | averaging)) != 0) {
+            return false;
+        }
+        odrHz = hz;
+        return true;
+    }
+
+    uint16_t getDataRate() const { return odrHz; }
+
+    void setWatermark(uint8_t samples) {
+        samples = constrain(samples, 1, MAX_WATERMARK);
+        i2cBus.write(address, REG_FIFO_WTM, samples);
+        watermark = samples;
+    }
+
+    uint8_t getWatermark() const { return watermark; }
+
+    bool usesInterrupt() const { return intPin >= 0; }
+
+    /**
+     * @brief Raise INT while the pressure is above an absolute level
+     *
+     * The LPS28 has one INT pin; this gives it to the threshold event, so
+     * construct the sampler without an intPin (FIFO polled) to use it.
+     * The comparison runs in the sensor on every sample, so INT rises
+     * within one ODR period of the crossing, without any bus traffic.
+     */
+    bool setHighThreshold(float hPa) {
+        uint16_t threshold = constrain(hPa * THS_LSB_PER_HPA, 1.0f, 32767.0f);
+        uint8_t data[2] = {(uint8_t)(threshold & 0xFF), (uint8_t)(threshold >> 8)};
+        return i2cBus.write(address, REG_THS_P_L, data, 2) == 0 &&
+               i2cBus.write(address, REG_INTERRUPT_CFG, INTERRUPT_PHE) == 0 &&
+               i2cBus.write(address, REG_CTRL4, CTRL4_INT_EN) == 0;
+    }
+
+    /**
+     * @brief Read the newest sample straight from the output registers
+     *
+     * Independent of the FIFO and the sampler task, for safety checks.
+     */
+    bool readPressureNow(float& hPa, I2CPriority priority = I2CPriority::Realtime) {
+        uint8_t data[3];
+        if (i2cBus.read(address, REG_PRESS_OUT, data, 3, priority) != 0) {
+            return false;
+        }
+        hPa = decodePressure(data);
+        return true;
+    }
+
+    /**
+     * @brief Take the next unread sample (single consumer)
+     *
+     * @return false if there is nothing new
+     */
+    bool pop(PressureSample& out) {
+        uint32_t end = writeIndex.load(std::memory_order_acquire);
+        if (end - readIndex > RING_SIZE) {
+            missedCount += end - readIndex - RING_SIZE;
+            readIndex = end - RING_SIZE;
+        }
+        while (readIndex != end) {
+            uint32_t index = readIndex++;
+            if (readSlot(index, out)) {
+                return true;
+            }
+            missedCount++;  // Overwritten while reading
+        }
+        return false;
+    }
+
+    /**
+     * @brief Newest sample, without consuming anything
+     *
+     * @return false if there is none yet
+     */
+    bool latest(PressureSample& out) const {
+        uint32_t end = writeIndex.load(std::memory_order_acquire);
+        return end != 0 && readSlot(end - 1, out);
+    }
+
+    Stats getStats() const {
+        Stats s;
+        s.samples = samples;
+        s.bursts = bursts;
+        s.interrupts = interrupts;
+        s.polls = polls;
+        s.readErrors = readErrors;
+        s.fifoOverruns = fifoOverruns;
+        s.missed = missedCount;
+        s.maxBurst = maxBurst;
+        return s;
+    }
+
+    void resetStats() {
+        samples = 0;
+        bursts = 0;
+        interrupts = 0;
+        polls = 0;
+        readErrors = 0;
+        fifoOverruns = 0;
+        missedCount = 0;
+        maxBurst = 0;
+    }
+
+    void printStats(Stream& out) const {
+        Stats s = getStats();
+        out.print("LPS28 sampler: ");
+        out.print(odrHz);
+        out.print(" Hz, ");
+        out.print(4 << averaging);
+        out.print(" averaged, watermark ");
+        out.print(watermark);
+        out.print(" (");
+        out.print(watermark * 1000 / odrHz);
+        out.println(usesInterrupt() ? " ms bursts on INT)" : " ms bursts, polled)");
+        out.print("  Samples: ");
+        out.print(s.samples);
+        out.print(" in ");
+        out.print(s.bursts);
+        out.print(" bursts (max ");
+        out.print(s.maxBurst);
+        out.print("), by INT: ");
+        out.print(s.interrupts);
+        out.print(", by timeout: ");
+        out.println(s.polls);
+        out.print("  Read errors: ");
+        out.print(s.readErrors);
+        out.print(", FIFO overruns: ");
+        out.print(s.fifoOverruns);
+        out.print(", missed by reader: ");
+        out.println(s.missed);
+        PressureSample sample;
+        if (latest(sample)) {
+            out.print("  Latest: ");
+            out.print(sample.pressureHPa, 2);
+            out.print(" hPa, ");
+            out.print(sample.temperatureC, 1);
+            out.println(" C");
+        }
+    }
+
+private:
+    static constexpr uint8_t REG_INTERRUPT_CFG = 0x0B;
+    static constexpr uint8_t REG_THS_P_L = 0x0C;
+    static constexpr uint8_t REG_WHO_AM_I = 0x0F;
+    static constexpr uint8_t REG_CTRL1 = 0x10;
+    static constexpr uint8_t REG_CTRL2 = 0x11;
+    static constexpr uint8_t REG_CTRL4 = 0x13;
+    static constexpr uint8_t REG_FIFO_CTRL = 0x14;
+    static constexpr uint8_t REG_FIFO_WTM = 0x15;
+    static constexpr uint8_t REG_FIFO_STATUS1 = 0x25;   // Unread samples; STATUS2 follows
+    static constexpr uint8_t REG_PRESS_OUT = 0x28;
+    static constexpr uint8_t REG_TEMP_OUT = 0x2B;
+    static constexpr uint8_t REG_FIFO_DATA = 0x78;
+
+    static constexpr uint8_t WHO_AM_I = 0xB4;
+    static constexpr uint8_t CTRL2_FS_MODE = 0x40;      // 4060 hPa full scale
+    static constexpr uint8_t CTRL2_BDU = 0x08;
+    static constexpr uint8_t CTRL2_SWRESET = 0x04;
+    static constexpr uint8_t CTRL4_INT_EN = 0x10;
+    static constexpr uint8_t CTRL4_FIFO_WTM = 0x02;
+    static constexpr uint8_t FIFO_BYPASS = 0x00;
+    static constexpr uint8_t FIFO_CONTINUOUS = 0x02;
+    static constexpr uint8_t STATUS2_OVR = 0x40;
+    static constexpr uint8_t INTERRUPT_PHE = 0x01;      // Pressure high event
+
+    static constexpr float LSB_PER_HPA = 2048.0f;       // Full-scale mode
+    static constexpr float THS_LSB_PER_HPA = 8.0f;      // Threshold, full-scale mode
+    static constexpr float LSB_PER_C = 100.0f;
+    static constexpr uint8_t SAMPLE_BYTES = 3;
+    static constexpr uint8_t SAMPLES_PER_READ = I2CBus::MAX_PAYLOAD / SAMPLE_BYTES;
+
+    struct Slot {
+        std::atomic<uint32_t> commit{0};  // Write index + 1 once complete, 0 while writing
+        PressureSample sample;
+    };
+
+    uint8_t address;
+    int8_t intPin;
+    uint8_t averaging = AVG_16;
+    volatile uint16_t odrHz = 100;
+    volatile uint8_t watermark = 4;
+    TaskHandle_t task = nullptr;
+    SemaphoreHandle_t dataReady = nullptr;
+
+    Slot slots[RING_SIZE];
+    std::atomic<uint32_t> writeIndex{0};
+    uint32_t readIndex = 0;               // Consumer only
+
+    volatile uint32_t samples = 0;
+    volatile uint32_t bursts = 0;
+    volatile uint32_t interrupts = 0;
+    volatile uint32_t polls = 0;
+    volatile uint32_t readErrors = 0;
+    volatile uint32_t fifoOverruns = 0;
+    volatile uint32_t missedCount = 0;
+    volatile uint8_t maxBurst = 0;
+
+    static uint8_t odrToCode(uint16_t hz) {
+        static const uint16_t rates[] = {1, 4, 10, 25, 50, 75, 100, 200};
+        for (uint8_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+            if (rates[i] == hz) return i + 1;
+        }
+        return 0;
+    }
+
+    static float decodePressure(const uint8_t* p) {
+        int32_t raw = (int32_t)((uint32_t)p[2] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[0] << 8) >> 8;
+        return raw / LSB_PER_HPA;
+    }
+
+    static void IRAM_ATTR onInterrupt(void* arg) {
+        auto self = static_cast<PressureSampler*>(arg);
+        BaseType_t woken = pdFALSE;
+        xSemaphoreGiveFromISR(self->dataReady, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+
+    bool readSlot(uint32_t index, PressureSample& out) const {
+        const Slot& slot = slots[index % RING_SIZE];
+        if (slot.commit.load(std::memory_order_acquire) != index + 1) {
+            return false;
+        }
+        out = slot.sample;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot.commit.load(std::memory_order_relaxed) == index + 1;
+    }
+
+    void publish(const PressureSample& sample) {
+        uint32_t index = writeIndex.load(std::memory_order_relaxed);
+        Slot& slot = slots[index % RING_SIZE];
+        slot.commit.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.sample = sample;
+        slot.commit.store(index + 1, std::memory_order_release);
+        writeIndex.store(index + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Read everything in the FIFO and publish it
+     */
+    void drainFifo(uint32_t& sequence) {
+        uint8_t status[2];
+        if (i2cBus.read(address, REG_FIFO_STATUS1, status, 2) != 0) {
+            readErrors++;
+            return;
+        }
+        uint8_t count = status[0];
+        if (status[1] & STATUS2_OVR) {
+            fifoOverruns++;  // At least one sample; the exact number is gone
+        }
+        if (count == 0) {
+            return;
+        }
+
+        uint8_t temp[2];
+        float temperatureC = 0;
+        if (i2cBus.read(address, REG_TEMP_OUT, temp, 2) == 0) {
+            temperatureC = (int16_t)((uint16_t)temp[1] << 8 | temp[0]) / LSB_PER_C;
+        }
+        // The newest sample is from about now, the others one ODR period apart
+        uint32_t nowUs = (uint32_t)esp_timer_get_time();
+        uint32_t periodUs = 1000000UL / odrHz;
+
+        uint8_t done = 0;
+        while (done < count) {
+            uint8_t n = min<uint8_t>(count - done, SAMPLES_PER_READ);
+            uint8_t data[SAMPLES_PER_READ * SAMPLE_BYTES];
+            if (i2cBus.read(address, REG_FIFO_DATA, data, n * SAMPLE_BYTES) != 0) {
+                readErrors++;
+                return;
+            }
+            for (uint8_t i = 0; i < n; i++) {
+                PressureSample sample;
+                sample.sequence = sequence++;
+                sample.timeUs = nowUs - (count - 1 - (done + i)) * periodUs;
+                sample.pressureHPa = decodePressure(&data[i * SAMPLE_BYTES]);
+                sample.temperatureC = temperatureC;
+                publish(sample);
+            }
+            done += n;
+        }
+        samples += count;
+        bursts++;
+        if (count > maxBurst) maxBurst = count;
+    }
+
+    static void taskLoop(void* param) {
+        auto self = static_cast<PressureSampler*>(param);
+        uint32_t sequence = 0;
+
+        while (true) {
+            // Wait for the watermark interrupt; without one (or if an edge
+            // was missed), the timeout drains the FIFO anyway
+            uint32_t burstMs = self->watermark * 1000UL / self->odrHz;
+            uint32_t timeoutMs = self->usesInterrupt() ? burstMs * 2 + 10 : burstMs;
+            if (xSemaphoreTake(self->dataReady, pdMS_TO_TICKS(max<uint32_t>(timeoutMs, 1))) == pdTRUE) {
+                self->interrupts++;
+            } else {
+                self->polls++;
+            }
+            self->drainFifo(sequence);
+            if (self->usesInterrupt() && digitalRead(self->intPin) == HIGH) {
+                // Refilled past the watermark while draining: INT never fell,
+                // so there will be no edge for it
+                xSemaphoreGive(self->dataReady);
+            }
+        }
+    }
+};
@@ -0,0 +1,146 @@
+#pragma once
+#include <Arduino.h>
+
+/**
+ * @brief RAM copy of a device's registers to drop redundant bus traffic
+ *
+ * Tracks the last value written to (or read from) each register of each
+ * page, and the currently selected page. Drivers ask the shadow before
+ * touching the bus:
+ *
+ *   if (shadow.write(page, reg, value)) { ...issue the write... }
+ *   if (!shadow.read(page, reg, value)) { ...read the device, then store()... }
+ *
+ * Registers the device changes by itself (status, temperature, self-clearing
+ * bits) must be marked with setVolatile() so they are never cached.
+ * After a device reset call invalidate().
+ *
+ * Not thread safe: use one shadow per driver, from the task that owns it.
+ */
+template <uint8_t PAGES>
+class RegisterShadow {
+public:
+    static constexpr uint8_t NO_PAGE = 0xFF;
+
+    struct Stats {
+        uint32_t issuedWrites;
+        uint32_t suppressedWrites;
+        uint32_t deviceReads;
+        uint32_t cachedReads;
+    };
+
+    RegisterShadow() {
+        invalidate();
+    }
+
+    /**
+     * @brief Forget all register values and the selected page
+     */
+    void invalidate() {
+        memset(known, 0, sizeof(known));
+        page = NO_PAGE;
+    }
+
+    void invalidate(uint8_t p, uint8_t reg) {
+        if (p < PAGES) clearBit(known[p], reg);
+    }
+
+    void setVolatile(uint8_t p, uint8_t reg) {
+        if (p < PAGES) setBit(volatileRegs[p], reg);
+    }
+
+    /**
+     * @brief Record a page change
+     *
+     * @return true if the page register has to be written
+     */
+    bool selectPage(uint8_t p) {
+        if (p == page) {
+            stats.suppressedWrites++;
+            return false;
+        }
+        page = p;
+        stats.issuedWrites++;
+        return true;
+    }
+
+    uint8_t currentPage() const { return page; }
+
+    /**
+     * @brief Record a register write
+     *
+     * @return true if the value differs from the shadow and must be written
+     */
+    bool write(uint8_t p, uint8_t reg, uint8_t value) {
+        if (p < PAGES && !isVolatile(p, reg) && testBit(known[p], reg) && values[p][reg] == value) {
+            stats.suppressedWrites++;
+            return false;
+        }
+        store(p, reg, value);
+        stats.issuedWrites++;
+        return true;
+    }
+
+    /**
+     * @brief Record a burst that was written without asking write() per byte
+     */
+    void storeBurst(uint8_t p, uint8_t reg, const uint8_t* data, uint8_t length) {
+        for (uint8_t i = 0; i < length; i++) {
+            store(p, reg + i, data[i]);
+        }
+        stats.issuedWrites++;
+    }
+
+    /**
+     * @brief Serve a read from the shadow
+     *
+     * @return false if the value is unknown; read the device and store() it
+     */
+    bool read(uint8_t p, uint8_t reg, uint8_t& value) {
+        if (p < PAGES && !isVolatile(p, reg) && testBit(known[p], reg)) {
+            value = values[p][reg];
+            stats.cachedReads++;
+            return true;
+        }
+        stats.deviceReads++;
+        return false;
+    }
+
+    void store(uint8_t p, uint8_t reg, uint8_t value) {
+        if (p >= PAGES || isVolatile(p, reg)) return;
+        values[p][reg] = value;
+        setBit(known[p], reg);
+    }
+
+    const Stats& getStats() const { return stats; }
+
+    void resetStats() {
+        stats = {};
+    }
+
+    void printStats(Stream& out, const char* name) const {
+        out.print(name);
+        out.print(": ");
+        out.print(stats.issuedWrites);
+        out.print(" writes issued, ");
+        out.print(stats.suppressedWrites);
+        out.print(" suppressed; ");
+        out.print(stats.deviceReads);
+        out.print(" reads from device, ");
+        out.print(stats.cachedReads);
+        out.println(" from cache");
+    }
+
+private:
+    uint8_t values[PAGES][256];
+    uint32_t known[PAGES][8];
+    uint32_t volatileRegs[PAGES][8] = {};
+    uint8_t page;
+    Stats stats = {};
+
+    bool isVolatile(uint8_t p, uint8_t reg) const { return testBit(volatileRegs[p], reg); }
+
+    static bool testBit(const uint32_t* bits, uint8_t i) { return bits[i >> 5] & (1u << (i & 31)); }
+    static void setBit(uint32_t* bits, uint8_t i) { bits[i >> 5] |= 1u << (i & 31); }
+    static void clearBit(uint32_t* bits, uint8_t i) { bits[i >> 5] &= ~(1u << (i & 31)); }
+};
@@ -0,0 +1,115 @@
+#pragma once
+#include <Arduino.h>
+#include <esp_attr.h>
+#include <esp_rom_gpio.h>
+#include <esp_timer.h>
+#include <soc/gpio_reg.h>
+#include <soc/gpio_sig_map.h>
+#include <soc/soc.h>
+#include <atomic>
+
+/**
+ * @brief Forces actuator pins to a safe level from any context, ISRs included
+ *
+ * trip() takes each pin away from its peripheral (LEDC) by routing the
+ * plain GPIO output register to it through the GPIO matrix, and drives it
+ * to its safe level. It only writes registers and calls a ROM function, so
+ * it is safe from interrupts and from any task, and takes a few
+ * microseconds whatever the rest of the firmware is doing. The PWM keeps
+ * running internally but no longer reaches the pin.
+ *
+ * rearm() gives the pins back to their LEDC channels; call it from a task
+ * after setting safe duties.
+ *
+ * Trip time and reason are kept for latency reporting: callers pass the
+ * time the fault was detected (or injected), trip() records the delay to
+ * the pins being forced.
+ */
+class SafetyCutoff {
+public:
+    static constexpr uint8_t MAX_PINS = 4;
+
+    struct Stats {
+        uint32_t trips;
+        uint32_t lastLatencyUs;    // Fault detected -> pins forced
+        uint32_t maxLatencyUs;
+        uint8_t lastReason;
+    };
+
+    /**
+     * @brief Register a pin driven by an LEDC channel
+     *
+     * @param safeLevel Level the pin is forced to on trip
+     */
+    bool addPin(uint8_t pin, uint8_t ledcChannel, bool safeLevel = false) {
+        if (pinCount >= MAX_PINS) {
+            return false;
+        }
+        pins[pinCount++] = {pin, ledcChannel, safeLevel};
+        return true;
+    }
+
+    /**
+     * @brief Force all pins to their safe level (ISR safe)
+     *
+     * @param detectedUs esp_timer time the fault was detected
+     * @param reason Caller-defined code, reported by getStats()
+     */
+    void IRAM_ATTR trip(uint32_t detectedUs, uint8_t reason) {
+        for (uint8_t i = 0; i < pinCount; i++) {
+            const Pin& p = pins[i];
+            setLevel(p.pin, p.safeLevel);
+            esp_rom_gpio_connect_out_signal(p.pin, SIG_GPIO_OUT_IDX, false, false);
+        }
+        uint32_t latency = (uint32_t)esp_timer_get_time() - detectedUs;
+
+        if (!tripped.exchange(true)) {
+            // First trip since rearm: this is the one that counts
+            stats.trips++;
+            stats.lastLatencyUs = latency;
+            stats.lastReason = reason;
+            if (latency > stats.maxLatencyUs) stats.maxLatencyUs = latency;
+        }
+    }
+
+    bool isTripped() const {
+        return tripped.load();
+    }
+
+    /**
+     * @brief Give the pins back to the PWM (task context only)
+     */
+    void rearm() {
+        for (uint8_t i = 0; i < pinCount; i++) {
+            ledcAttachPin(pins[i].pin, pins[i].ledcChannel);
+        }
+        tripped.store(false);
+    }
+
+    Stats getStats() const { return stats; }
+
+    void resetStats() {
+        stats = {};
+    }
+
+private:
+    struct Pin {
+        uint8_t pin;
+        uint8_t ledcChannel;
+        bool safeLevel;
+    };
+
+    Pin pins[MAX_PINS] = {};
+    uint8_t pinCount = 0;
+    std::atomic<bool> tripped{false};
+    Stats stats = {};
+
+    static void IRAM_ATTR setLevel(uint8_t pin, bool level) {
+        // Output enable is already set by the LEDC attach
+        if (pin < 32) {
+            REG_WRITE(level ? GPIO_OUT_W1TS_REG : GPIO_OUT_W1TC_REG, BIT(pin));
+        } else {
+            REG_WRITE(level ? GPIO_OUT1_W1TS_REG : GPIO_OUT1_W1TC_REG, BIT(pin - 32));
+        }
+    }
+};
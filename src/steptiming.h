@@ -0,0 +1,214 @@
+#pragma once
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+
+/**
+ * @brief Per-step timing statistics of a playback task
+ *
+ * Lateness is the time between a step's deadline and the moment it starts
+ * (deadline-driven playback only). Cost is the time spent producing and
+ * writing the output. Used by HapticPlayer and EnvelopePlayer.
+ */
+struct StepTimingStats {
+    static constexpr uint8_t NUM_BUCKETS = 6;
+    // Upper bounds (us) of the histogram buckets, the last bucket is open-ended
+    static constexpr int32_t BUCKET_LIMITS_US[NUM_BUCKETS - 1] = {50, 100, 250, 500, 1000};
+
+    uint32_t steps = 0;
+    uint32_t resyncs = 0;       // Deadlines dropped because we fell too far behind
+    int32_t maxLateUs = 0;
+    int64_t totalLateUs = 0;
+    uint32_t buckets[NUM_BUCKETS] = {};
+    int32_t maxCostUs = 0;
+    int64_t totalCostUs = 0;
+    // Touch-through: reading taken -> RTP write queued
+    uint32_t touchUpdates = 0;
+    uint32_t maxTouchLatencyUs = 0;
+    uint64_t totalTouchLatencyUs = 0;
+
+    void recordTouchLatency(uint32_t latencyUs) {
+        touchUpdates++;
+        totalTouchLatencyUs += latencyUs;
+        if (latencyUs > maxTouchLatencyUs) maxTouchLatencyUs = latencyUs;
+    }
+
+    void recordCost(int32_t costUs) {
+        totalCostUs += costUs;
+        if (costUs > maxCostUs) maxCostUs = costUs;
+    }
+
+    void record(int32_t lateUs) {
+        steps++;
+        totalLateUs += lateUs;
+        if (lateUs > maxLateUs) maxLateUs = lateUs;
+        uint8_t b = 0;
+        while (b < NUM_BUCKETS - 1 && lateUs >= BUCKET_LIMITS_US[b]) b++;
+        buckets[b]++;
+    }
+
+    void printLateness(Stream& out) const {
+        out.print("  Lateness avg: ");
+        out.print(steps ? (int32_t)(totalLateUs / steps) : 0);
+        out.print(" us, max: ");
+        out.print(maxLateUs);
+        out.println(" us");
+    }
+
+    /**
+     * @param what Name of a step's work ("Tick", "Output")
+     */
+    void printCost(Stream& out, const char* what) const {
+        out.print("  ");
+        out.print(what);
+        out.print(" cost avg: ");
+        out.print(steps ? (int32_t)(totalCostUs / steps) : 0);
+        out.print(" us, max: ");
+        out.print(maxCostUs);
+        out.println(" us");
+    }
+
+    void printHistogram(Stream& out) const {
+        out.print("  Histogram:");
+        for (uint8_t b = 0; b < NUM_BUCKETS; b++) {
+            out.print(b < NUM_BUCKETS - 1 ? " <" : " >=");
+            out.print(BUCKET_LIMITS_US[b < NUM_BUCKETS - 1 ? b : b - 1]);
+            out.print("us:");
+            out.print(buckets[b]);
+        }
+        out.println();
+    }
+};
+
+/**
+ * @brief Absolute step deadlines for a playback task, and their stats
+ *
+ * Each deadline is derived from the previous one, not from the wake-up
+ * time, so late wake-ups do not push the rest of the playback back; steps
+ * later than MAX_LATENESS_US restart the timeline instead of catching up
+ * in a burst. sleep() arms an esp_timer one-shot for the deadline, so
+ * timing has microsecond resolution rather than the FreeRTOS tick.
+ *
+ * The owning task updates the stats under a sequence counter; any task
+ * can take a consistent copy with getStats().
+ */
+class DeadlineClock {
+public:
+    static constexpr int32_t MAX_LATENESS_US = 20000;
+
+    /**
+     * @brief Create the wake-up timer
+     *
+     * @param name esp_timer name, for esp_timer_dump()
+     */
+    bool begin(const char* name) {
+        if (timer != nullptr) {
+            return true;
+        }
+        esp_timer_create_args_t timerArgs = {};
+        timerArgs.callback = &DeadlineClock::onTimer;
+        timerArgs.arg = this;
+        timerArgs.dispatch_method = ESP_TIMER_TASK;
+        timerArgs.name = name;
+        return esp_timer_create(&timerArgs, &timer) == ESP_OK;
+    }
+
+    /**
+     * @brief Start the timeline now (owning task)
+     *
+     * Also makes the calling task the one sleep() wakes up.
+     */
+    void restart() {
+        task = xTaskGetCurrentTaskHandle();
+        nextDeadlineUs = esp_timer_get_time();
+    }
+
+    /**
+     * @brief Block until the next deadline
+     *
+     * Any task notification ends the wait early, so the owner can also be
+     * woken for requests.
+     *
+     * @return true if the deadline has passed
+     */
+    bool sleep() {
+        int64_t waitUs = nextDeadlineUs - esp_timer_get_time();
+        if (waitUs > 0) {
+            esp_timer_start_once(timer, waitUs);
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            esp_timer_stop(timer);  // Woken by something else
+        }
+        return esp_timer_get_time() >= nextDeadlineUs;
+    }
+
+    /**
+     * @brief Record the step that started at nowUs and schedule the next
+     *
+     * @param periodUs Time from this step's deadline to the next one
+     */
+    void advance(int64_t nowUs, uint32_t periodUs) {
+        int32_t lateUs = (int32_t)(nowUs - nextDeadlineUs);
+        bool resync = lateUs > MAX_LATENESS_US;
+        updateStats([&](StepTimingStats& stats) {
+            stats.record(lateUs);
+            if (resync) stats.resyncs++;
+        });
+        if (resync) {
+            nextDeadlineUs = nowUs;
+        }
+        nextDeadlineUs += periodUs;
+    }
+
+    /**
+     * @brief Change the stats from the owning task (cost, extra counters)
+     */
+    template <class F>
+    void updateStats(F update) {
+        seq.fetch_add(1, std::memory_order_acq_rel);
+        if (resetRequested) {
+            stats = StepTimingStats();
+            resetRequested = false;
+        }
+        update(stats);
+        seq.fetch_add(1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Consistent copy of the stats (any task)
+     *
+     * Retries until it reads a copy that was not modified halfway through.
+     */
+    StepTimingStats getStats() const {
+        StepTimingStats copy;
+        uint32_t before, after;
+        do {
+            before = seq.load(std::memory_order_acquire);
+            copy = stats;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = seq.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+        return copy;
+    }
+
+    /**
+     * @brief Clear the stats at the owner's next update
+     */
+    void resetStats() {
+        resetRequested = true;
+    }
+
+private:
+    esp_timer_handle_t timer = nullptr;
+    TaskHandle_t task = nullptr;
+    int64_t nextDeadlineUs = 0;
+    StepTimingStats stats;
+    std::atomic<uint32_t> seq{0};
+    volatile bool resetRequested = false;
+
+    static void onTimer(void* arg) {
+        // Runs in the esp_timer task: wake the owner for its deadline
+        xTaskNotifyGive(static_cast<DeadlineClock*>(arg)->task);
+    }
+};
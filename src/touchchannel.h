@@ -0,0 +1,51 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * @brief Latest touch reading shared between an input task and the haptic task
+ *
+ * Single writer, any number of readers, no locks: the writer bumps a
+ * sequence counter around each update and readers retry if it changed
+ * under them (or is odd, i.e. an update is in progress).
+ */
+struct TouchSample {
+    uint16_t value;      // 14-bit, after the input's mapping
+    uint32_t timeUs;     // esp_timer time of the reading (low 32 bits)
+    uint32_t sequence;   // Increments with every reading
+};
+
+class TouchChannel {
+public:
+    static constexpr uint16_t MAX_VALUE = 16383;
+
+    void publish(uint16_t value, uint32_t timeUs) {
+        uint32_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        latestValue.store(value, std::memory_order_relaxed);
+        latestTimeUs.store(timeUs, std::memory_order_relaxed);
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    /**
+     * @return false if nothing was published yet
+     */
+    bool read(TouchSample& out) const {
+        uint32_t before, after;
+        do {
+            before = sequence.load(std::memory_order_acquire);
+            out.value = latestValue.load(std::memory_order_relaxed);
+            out.timeUs = latestTimeUs.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+        out.sequence = before >> 1;
+        return before != 0;
+    }
+
+private:
+    std::atomic<uint32_t> sequence{0};
+    std::atomic<uint16_t> latestValue{0};
+    std::atomic<uint32_t> latestTimeUs{0};
+};
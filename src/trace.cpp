@@ -0,0 +1,191 @@
+#include "trace.h"
+#include <esp_timer.h>
+#include <algorithm>
+
+Tracer tracer;
+
+static const char* const PATH_NAMES[(uint8_t)TracePath::COUNT] = {
+    "FSR touch-through",
+    "FSR CC22",
+    "BLE CC22",
+    "CC23 heat",
+    "CC24 air",
+};
+
+static const char* const STAGE_NAMES[(uint8_t)TraceStage::COUNT] = {
+    "input", "dispatch", "sink", "actuator",
+};
+
+void Tracer::begin(TracePath path) {
+    if (!isEnabled() || (uint8_t)path >= (uint8_t)TracePath::COUNT) {
+        return;
+    }
+    uint16_t sequence = nextSequence.fetch_add(1, std::memory_order_relaxed);
+    if (sequence == 0) {
+        sequence = nextSequence.fetch_add(1, std::memory_order_relaxed);  // 0 means "none open"
+    }
+    openSequence[(uint8_t)path].store(sequence, std::memory_order_relaxed);
+    openTimeUs[(uint8_t)path].store((uint32_t)esp_timer_get_time(), std::memory_order_relaxed);
+    record(path, TraceStage::Input, sequence);
+}
+
+void Tracer::beginIfIdle(TracePath path) {
+    if (!isEnabled() || (uint8_t)path >= (uint8_t)TracePath::COUNT) {
+        return;
+    }
+    uint16_t open = openSequence[(uint8_t)path].load(std::memory_order_relaxed);
+    bool inFlight = open != 0 && doneSequence[(uint8_t)path].load(std::memory_order_relaxed) != open;
+    uint32_t ageUs = (uint32_t)esp_timer_get_time() - openTimeUs[(uint8_t)path].load(std::memory_order_relaxed);
+    if (inFlight && ageUs < IDLE_TIMEOUT_US) {
+        return;
+    }
+    begin(path);
+}
+
+void Tracer::stamp(TracePath path, TraceStage stage) {
+    if (!isEnabled() || (uint8_t)path >= (uint8_t)TracePath::COUNT) {
+        return;
+    }
+    uint16_t sequence = openSequence[(uint8_t)path].load(std::memory_order_relaxed);
+    if (sequence == 0) {
+        return;  // Nothing started on this path yet
+    }
+    record(path, stage, sequence);
+    if (stage == TraceStage::Actuator) {
+        doneSequence[(uint8_t)path].store(sequence, std::memory_order_relaxed);
+    }
+}
+
+void Tracer::record(TracePath path, TraceStage stage, uint16_t sequence) {
+    uint32_t index = writeIndex.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = slots[index % CAPACITY];
+    slot.commit.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.stamp.timeUs = (uint32_t)esp_timer_get_time();
+    slot.stamp.sequence = sequence;
+    slot.stamp.path = (uint8_t)path;
+    slot.stamp.stage = (uint8_t)stage;
+    slot.commit.store(index + 1, std::memory_order_release);
+}
+
+void Tracer::clear() {
+    for (uint8_t p = 0; p < (uint8_t)TracePath::COUNT; p++) {
+        openSequence[p].store(0, std::memory_order_relaxed);
+        doneSequence[p].store(0, std::memory_order_relaxed);
+    }
+    for (uint16_t i = 0; i < CAPACITY; i++) {
+        slots[i].commit.store(0, std::memory_order_relaxed);
+    }
+}
+
+namespace {
+
+// Stamps of one event, matched by sequence number
+struct TracedEvent {
+    uint16_t sequence;
+    uint8_t seen;  // Bit per stage
+    uint32_t timeUs[(uint8_t)TraceStage::COUNT];
+};
+
+uint32_t percentile(uint32_t* sorted, uint16_t count, uint8_t pct) {
+    uint16_t i = ((uint32_t)(count - 1) * pct + 50) / 100;
+    return sorted[i];
+}
+
+}  // namespace
+
+void Tracer::printReport(Stream& out) const {
+    // Snapshot the committed stamps, oldest first. Static: too big for the loop stack.
+    static Stamp snapshot[CAPACITY];
+    static TracedEvent events[CAPACITY];
+    static uint32_t latencies[CAPACITY];
+
+    uint32_t end = writeIndex.load(std::memory_order_acquire);
+    uint32_t start = end > CAPACITY ? end - CAPACITY : 0;
+    uint16_t count = 0;
+    for (uint32_t index = start; index < end; index++) {
+        const Slot& slot = slots[index % CAPACITY];
+        if (slot.commit.load(std::memory_order_acquire) != index + 1) continue;
+        Stamp copy = slot.stamp;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.commit.load(std::memory_order_relaxed) != index + 1) continue;  // Overwritten meanwhile
+        snapshot[count++] = copy;
+    }
+
+    out.print("Latency trace (");
+    out.print(count);
+    out.print(" stamps");
+    if (!isEnabled()) out.print(", tracing off");
+    out.println(")");
+
+    bool any = false;
+    for (uint8_t p = 0; p < (uint8_t)TracePath::COUNT; p++) {
+        // Group this path's stamps by event
+        uint16_t numEvents = 0;
+        for (uint16_t i = 0; i < count; i++) {
+            const Stamp& s = snapshot[i];
+            if (s.path != p) continue;
+            TracedEvent* e = nullptr;
+            for (int16_t j = numEvents - 1; j >= 0; j--) {
+                if (events[j].sequence == s.sequence) {
+                    e = &events[j];
+                    break;
+                }
+            }
+            if (e == nullptr) {
+                e = &events[numEvents++];
+                e->sequence = s.sequence;
+                e->seen = 0;
+            }
+            // First actuator write after the input is the one that counts
+            if (!(e->seen & (1 << s.stage))) {
+                e->seen |= 1 << s.stage;
+                e->timeUs[s.stage] = s.timeUs;
+            }
+        }
+
+        const uint8_t complete = (1 << (uint8_t)TraceStage::Input) | (1 << (uint8_t)TraceStage::Actuator);
+        uint16_t n = 0;
+        for (uint16_t j = 0; j < numEvents; j++) {
+            if ((events[j].seen & complete) != complete) continue;
+            latencies[n++] = events[j].timeUs[(uint8_t)TraceStage::Actuator] - events[j].timeUs[(uint8_t)TraceStage::Input];
+        }
+        if (n == 0) continue;
+        any = true;
+
+        std::sort(latencies, latencies + n);
+        out.print("  ");
+        out.print(PATH_NAMES[p]);
+        out.print(": n=");
+        out.print(n);
+        out.print(", p50 ");
+        out.print(percentile(latencies, n, 50));
+        out.print(" us, p99 ");
+        out.print(percentile(latencies, n, 99));
+        out.print(" us, max ");
+        out.print(latencies[n - 1]);
+        out.println(" us");
+
+        // Median time from input to each intermediate stage
+        out.print("    from input (p50):");
+        for (uint8_t stage = (uint8_t)TraceStage::Dispatch; stage < (uint8_t)TraceStage::COUNT; stage++) {
+            uint16_t m = 0;
+            for (uint16_t j = 0; j < numEvents; j++) {
+                const TracedEvent& e = events[j];
+                if (!(e.seen & (1 << (uint8_t)TraceStage::Input)) || !(e.seen & (1 << stage))) continue;
+                latencies[m++] = e.timeUs[stage] - e.timeUs[(uint8_t)TraceStage::Input];
+            }
+            if (m == 0) continue;
+            std::sort(latencies, latencies + m);
+            out.print(" ");
+            out.print(STAGE_NAMES[stage]);
+            out.print(" ");
+            out.print(percentile(latencies, m, 50));
+            out.print(" us");
+        }
+        out.println();
+    }
+    if (!any) {
+        out.println("  No complete input -> actuator events yet");
+    }
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include <Arduino.h>
+#include <Control_Surface.h>
+#include <atomic>
+
+/**
+ * @brief Latency paths from an input to the actuator it drives
+ */
+enum class TracePath : uint8_t {
+    FsrTouch,   // FSR ADC block -> RTP write (touch-through)
+    FsrMidi,    // FSR CC22 -> pipes -> sink -> RTP write
+    BleCC22,    // Bluetooth CC22 -> pipes -> sink (jitter buffer) -> RTP write
+    CC23Heat,   // CC23 (encoder or Bluetooth) -> pipes -> sink -> ledcWrite
+    CC24Air,    // CC24 (encoder or Bluetooth) -> pipes -> sink -> ledcWrite
+    COUNT,
+    None = 0xFF
+};
+
+enum class TraceStage : uint8_t {
+    Input,      // Reading taken / message first seen
+    Dispatch,   // Passed through a MIDI pipe
+    Sink,       // Reached the sink that applies it
+    Actuator,   // Output written
+    COUNT
+};
+
+/**
+ * @brief Lock-free latency tracer
+ *
+ * Any task can stamp events; each stamp is {time, path, stage, sequence}.
+ * begin() opens a new sequence number for a path and later stamps on the
+ * same path use it, so the stages of one event can be matched up (events
+ * on one path are handled in order, so "the latest" is the right one).
+ *
+ * Stamps go into a fixed ring: writers claim a slot with one atomic add
+ * and publish it with a per-slot commit counter, so there is no lock and
+ * old stamps are simply overwritten. printReport() takes a snapshot and
+ * prints p50/p99/max of input -> actuator per path, plus the median of
+ * each stage.
+ *
+ * Off until setEnabled(true) (CLI `trace on`), so it costs nothing by
+ * default.
+ */
+class Tracer {
+public:
+    static constexpr uint16_t CAPACITY = 256;
+    // beginIfIdle() gives up on an event that never reached its actuator after this
+    static constexpr uint32_t IDLE_TIMEOUT_US = 100000;
+
+    /**
+     * @brief Start tracing an event on a path (stamps TraceStage::Input)
+     */
+    void begin(TracePath path);
+
+    /**
+     * @brief begin(), unless the path's last event is still on its way
+     *
+     * For inputs that change far more often than their events complete
+     * (the FSR block task): one event in flight at a time keeps them from
+     * flooding the ring and evicting the other paths' stamps.
+     */
+    void beginIfIdle(TracePath path);
+
+    /**
+     * @brief Stamp a later stage of the latest event on a path
+     */
+    void stamp(TracePath path, TraceStage stage);
+
+    void setEnabled(bool on) { enabled.store(on, std::memory_order_relaxed); }
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    void clear();
+    void printReport(Stream& out) const;
+
+private:
+    struct Stamp {
+        uint32_t timeUs;
+        uint16_t sequence;
+        uint8_t path;
+        uint8_t stage;
+    };
+
+    struct Slot {
+        std::atomic<uint32_t> commit{0};  // Write index + 1 once the stamp is complete
+        Stamp stamp;
+    };
+
+    Slot slots[CAPACITY];
+    std::atomic<uint32_t> writeIndex{0};
+    std::atomic<uint16_t> openSequence[(uint8_t)TracePath::COUNT] = {};
+    std::atomic<uint16_t> doneSequence[(uint8_t)TracePath::COUNT] = {};  // Last to reach the actuator
+    std::atomic<uint32_t> openTimeUs[(uint8_t)TracePath::COUNT] = {};
+    std::atomic<uint16_t> nextSequence{1};
+    std::atomic<bool> enabled{false};
+
+    void record(TracePath path, TraceStage stage, uint16_t sequence);
+};
+
+extern Tracer tracer;
+
+/**
+ * @brief MIDI pipe that stamps one controller number as it passes
+ *
+ * Use in place of a factory pipe on a route:
+ *
+ *   TracingPipe ccPipe {23, TracePath::CC23Heat, TraceStage::Input};
+ *   Control_Surface >> ccPipe >> heatSink;
+ *
+ * With TraceStage::Input the pipe starts a new trace (the message source
+ * has no earlier stamp), otherwise it stamps the given stage.
+ */
+class TracingPipe : public MIDI_Pipe {
+public:
+    TracingPipe(uint8_t controller, TracePath path, TraceStage stage)
+        : controller(controller), path(path), stage(stage) {}
+
+protected:
+    using MIDI_Pipe::mapForwardMIDI;
+
+    void mapForwardMIDI(ChannelMessage msg) override {
+        if (msg.getMessageType() == MIDIMessageType::ControlChange && msg.getData1() == controller) {
+            if (stage == TraceStage::Input) {
+                tracer.begin(path);
+            } else {
+                tracer.stamp(path, stage);
+            }
+        }
+        sourceMIDItoSink(msg);
+    }
+
+private:
+    uint8_t controller;
+    TracePath path;
+    TraceStage stage;
+};
@@ -0,0 +1,151 @@
+/**
+ * Regulators against their plant models
+ *
+ * Steps each controller, with the gains and limits of its main file,
+ * against the plant model in controlloop.h (the same run as `heatpi sim`
+ * and `airpid sim` on the device) and checks the step response against fixed bounds.
+ * Keep the gains below in step with the main files.
+ */
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+#include <unity.h>
+#include "controlloop.h"
+
+// main_heat_bit.cpp
+static const float HEAT_KP = 0.02f;
+static const float HEAT_KI = 2.0f;
+static const float HEAT_SAMPLE_S = 0.02128f;  // INA219 default averaging: 32 + 8 samples
+
+// main_air_bit.cpp
+static const float AIR_KP = 0.15f;
+static const float AIR_KI = 0.05f;
+static const float AIR_KD = 0.005f;
+static const float AIR_INTEGRAL_LIMIT = 0.3f;
+static const float AIR_OUTPUT_RATE_PER_S = 4.0f;
+static const float AIR_SAMPLE_S = 0.01f;      // LPS28 at 100 Hz, one sample per step while regulating
+
+struct StepBounds {
+    float target;
+    float maxSettlingS;
+    float maxOvershootPct;
+    float maxSteadyStateError;
+};
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void checkStep(const StepMetrics::Result& r, const StepBounds& bounds) {
+    TEST_ASSERT_TRUE(r.riseTimeS >= 0);
+    TEST_ASSERT_TRUE(r.settlingTimeS >= 0);
+    TEST_ASSERT_LESS_THAN_FLOAT(bounds.maxSettlingS, r.settlingTimeS);
+    TEST_ASSERT_LESS_THAN_FLOAT(bounds.maxOvershootPct, r.overshootPct);
+    TEST_ASSERT_FLOAT_WITHIN(bounds.maxSteadyStateError, 0.0f, r.steadyStateError);
+}
+
+void test_heat_pi_steps(void) {
+    // Watts; settling is within 5% of the step, noise is 0.03 W
+    const StepBounds steps[] = {
+        {2.0f, 0.5f, 5.0f, 0.05f},
+        {4.0f, 0.5f, 5.0f, 0.05f},
+        {8.0f, 0.5f, 5.0f, 0.05f},
+    };
+    for (const StepBounds& bounds : steps) {
+        PIController controller(HEAT_KP, HEAT_KI);
+        checkStep(simulateStep(controller, HeatPlantModel(), bounds.target, HEAT_SAMPLE_S, 5.0f), bounds);
+    }
+}
+
+void test_heat_pi_holds_as_the_pad_warms(void) {
+    // Pad resistance rises with temperature: the integral has to follow
+    PIController controller(HEAT_KP, HEAT_KI);
+    StepMetrics::Result r = simulateStep(controller, HeatPlantModel(), 8.0f, HEAT_SAMPLE_S, 120.0f);
+    TEST_ASSERT_LESS_THAN_FLOAT(0.5f, r.settlingTimeS);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 0.0f, r.steadyStateError);
+}
+
+void test_heat_pi_recovers_from_saturation(void) {
+    // Beyond what the pad can take: duty pins at 1 without winding up
+    PIController controller(HEAT_KP, HEAT_KI);
+    HeatPlantModel plant;
+    float duty = 0;
+    for (int i = 0; i < 500; i++) {
+        duty = controller.update(20.0f, plant.step(duty, HEAT_SAMPLE_S), HEAT_SAMPLE_S);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.0f, duty);
+    // Back to a reachable target: settled within a few samples
+    StepMetrics metrics;
+    metrics.begin(0, plant.step(duty, HEAT_SAMPLE_S), 4.0f);
+    for (int i = 1; i <= 100; i++) {
+        float measured = plant.step(duty, HEAT_SAMPLE_S);
+        metrics.add(i * HEAT_SAMPLE_S, measured);
+        duty = controller.update(4.0f, measured, HEAT_SAMPLE_S);
+    }
+    StepMetrics::Result r = metrics.get();
+    TEST_ASSERT_TRUE(r.settlingTimeS >= 0);
+    TEST_ASSERT_LESS_THAN_FLOAT(0.5f, r.settlingTimeS);
+}
+
+static PIDController airController() {
+    PIDController controller(AIR_KP, AIR_KI, AIR_KD);
+    controller.setIntegralLimit(AIR_INTEGRAL_LIMIT);
+    controller.setOutputRateLimit(AIR_OUTPUT_RATE_PER_S);
+    return controller;
+}
+
+void test_air_pid_steps(void) {
+    // hPa above ambient, up to the CC24 full scale; the pump slows near stall
+    const StepBounds steps[] = {
+        {20.0f, 1.5f, 5.0f, 0.5f},
+        {60.0f, 3.0f, 5.0f, 0.5f},
+        {120.0f, 5.0f, 5.0f, 0.5f},
+        {200.0f, 9.0f, 5.0f, 0.5f},
+    };
+    for (const StepBounds& bounds : steps) {
+        PIDController controller = airController();
+        checkStep(simulateStep(controller, AirPlantModel(), bounds.target, AIR_SAMPLE_S, 20.0f), bounds);
+    }
+}
+
+void test_air_pid_deflates(void) {
+    // Settle at 120 hPa, then step down to 20 through the deflate pump
+    PIDController controller = airController();
+    AirPlantModel plant;
+    float command = 0;
+    float measured = 0;
+    for (int i = 0; i < 1000; i++) {
+        measured = plant.step(command, AIR_SAMPLE_S);
+        command = controller.update(120.0f, measured, AIR_SAMPLE_S);
+    }
+    StepMetrics metrics;
+    metrics.begin(0, measured, 20.0f);
+    for (int i = 1; i <= 1000; i++) {
+        measured = plant.step(command, AIR_SAMPLE_S);
+        metrics.add(i * AIR_SAMPLE_S, measured);
+        command = controller.update(20.0f, measured, AIR_SAMPLE_S);
+    }
+    checkStep(metrics.get(), {20.0f, 5.0f, 5.0f, 0.5f});
+}
+
+int runTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_heat_pi_steps);
+    RUN_TEST(test_heat_pi_holds_as_the_pad_warms);
+    RUN_TEST(test_heat_pi_recovers_from_saturation);
+    RUN_TEST(test_air_pid_steps);
+    RUN_TEST(test_air_pid_deflates);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000);  // Serial up
+    runTests();
+}
+
+void loop() {}
+#else
+int main(void) {
+    return runTests();
+}
+#endif
@@ -0,0 +1,131 @@
+/**
+ * Haptic mixer: voice handling, saturation and tick cost
+ *
+ * The benchmark is the host counterpart of the vibe bit's `mixbench`
+ * command: same effects, same voice counts. It prints ns per tick for
+ * 1..NUM_VOICES busy voices and fails if a tick takes more than a tenth
+ * of the 1 ms haptic tick.
+ */
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <chrono>
+#endif
+#include <stdio.h>
+#include <unity.h>
+#include "hapticmixer.h"
+#include "hapticeffects.h"
+
+static const uint32_t TICK_US = 1000;  // HapticPlayer::TICK_US
+
+static uint32_t nowUs() {
+#ifdef ARDUINO
+    return micros();
+#else
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+static constexpr HapticStep LONG_STEPS[] = {{100, 50}};
+static constexpr HapticEffect LONG = makeEffect(LONG_STEPS);
+static constexpr HapticStep FULL_STEPS[] = {{127, 10}};
+static constexpr HapticEffect FULL = makeEffect(FULL_STEPS);
+// Leading zero-length steps, more than the old retry budget
+static constexpr HapticStep GAPPED_STEPS[] = {{0, 0}, {0, 0}, {0, 0}, {0, 0}, {90, 2}};
+static constexpr HapticEffect GAPPED = makeEffect(GAPPED_STEPS);
+static constexpr HapticStep EMPTY_STEPS[] = {{50, 0}};
+static constexpr HapticEffect EMPTY = makeEffect(EMPTY_STEPS);
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_sum_saturates(void) {
+    HapticMixer mixer;
+    mixer.play(HapticMixer::BACKGROUND_VOICE, &FULL, HapticMixer::UNITY_Q15, true);
+    mixer.playOneShot(&FULL, HapticMixer::UNITY_Q15);
+    TEST_ASSERT_EQUAL_UINT8(HapticMixer::OUTPUT_MAX, mixer.render(TICK_US, HapticMixer::UNITY_Q15));
+    TEST_ASSERT_EQUAL_UINT32(1, mixer.getClippedTicks());
+    // Half master volume brings the sum back in range: (127 + 127) / 2
+    TEST_ASSERT_EQUAL_UINT8(127, mixer.render(TICK_US, HapticMixer::UNITY_Q15 / 2));
+}
+
+void test_one_shot_steals_the_oldest(void) {
+    HapticMixer mixer;
+    uint8_t first = mixer.playOneShot(&LONG, HapticMixer::UNITY_Q15);
+    uint8_t second = mixer.playOneShot(&LONG, HapticMixer::UNITY_Q15);
+    mixer.playOneShot(&LONG, HapticMixer::UNITY_Q15);
+    for (uint8_t i = 0; i < 10; i++) {
+        mixer.render(TICK_US, HapticMixer::UNITY_Q15);
+    }
+    TEST_ASSERT_EQUAL(first, mixer.playOneShot(&LONG, HapticMixer::UNITY_Q15));
+    TEST_ASSERT_EQUAL(second, mixer.playOneShot(&LONG, HapticMixer::UNITY_Q15));
+    TEST_ASSERT_EQUAL_UINT32(2, mixer.getSteals());
+}
+
+void test_zero_length_steps_are_skipped(void) {
+    HapticMixer mixer;
+    mixer.play(HapticMixer::BACKGROUND_VOICE, &GAPPED, HapticMixer::UNITY_Q15, true);
+    for (uint8_t i = 0; i < 20; i++) {
+        TEST_ASSERT_EQUAL_UINT8(90, mixer.render(TICK_US, HapticMixer::UNITY_Q15));
+    }
+}
+
+void test_background_survives_an_empty_effect(void) {
+    HapticMixer mixer;
+    mixer.play(HapticMixer::BACKGROUND_VOICE, &EMPTY, HapticMixer::UNITY_Q15, true);
+    TEST_ASSERT_EQUAL_UINT8(0, mixer.render(TICK_US, HapticMixer::UNITY_Q15));
+    // A one-shot voice with nothing to play is freed
+    mixer.playOneShot(&EMPTY, HapticMixer::UNITY_Q15);
+    mixer.render(TICK_US, HapticMixer::UNITY_Q15);
+    TEST_ASSERT_EQUAL(0, mixer.activeVoices());
+    // The background keeps its effect and plays a queued one
+    mixer.queue(HapticMixer::BACKGROUND_VOICE, &FULL);
+    TEST_ASSERT_EQUAL_UINT8(127, mixer.render(TICK_US, HapticMixer::UNITY_Q15));
+}
+
+void test_tick_cost(void) {
+    const uint32_t ticks = 20000;
+    for (uint8_t voices = 1; voices <= HapticMixer::NUM_VOICES; voices++) {
+        HapticMixer bench;
+        SynthControls controls;
+        for (uint8_t v = 0; v < voices; v++) {
+            // Mix of synth, encoded and raw effects, all looping
+            bench.play(v, EFFECT_LIBRARY[v % EFFECT_LIBRARY_SIZE], HapticMixer::UNITY_Q15 / 2, true, &controls);
+        }
+        uint32_t checksum = 0;
+        uint32_t t0 = nowUs();
+        for (uint32_t t = 0; t < ticks; t++) {
+            checksum += bench.render(TICK_US, HapticMixer::UNITY_Q15);
+        }
+        uint32_t nsPerTick = (uint32_t)((uint64_t)(nowUs() - t0) * 1000 / ticks);
+        char line[80];
+        snprintf(line, sizeof(line), "%u voice(s): %u ns/tick (checksum %u)",
+                 (unsigned)voices, (unsigned)nsPerTick, (unsigned)checksum);
+        TEST_MESSAGE(line);
+        TEST_ASSERT_LESS_THAN_UINT32(TICK_US * 1000 / 10, nsPerTick);
+    }
+}
+
+int runTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_sum_saturates);
+    RUN_TEST(test_one_shot_steals_the_oldest);
+    RUN_TEST(test_zero_length_steps_are_skipped);
+    RUN_TEST(test_background_survives_an_empty_effect);
+    RUN_TEST(test_tick_cost);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000);  // Serial up
+    runTests();
+}
+
+void loop() {}
+#else
+int main(void) {
+    return runTests();
+}
+#endif
@@ -0,0 +1,114 @@
+/**
+ * Golden output of the haptic synth
+ *
+ * HapticSynth is integer-only, so a patch renders the same amplitudes on
+ * every platform. These sequences were rendered once and are checked on
+ * the host (`pio test -e native`) and can be on a board
+ * (`pio test -e vibe_bit`): a mismatch on either means the synth changed.
+ */
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+#include <unity.h>
+#include "hapticeffects.h"
+
+struct GoldenPatch {
+    SynthPatch patch;
+    uint8_t rateCC;
+    uint8_t depthCC;
+    uint8_t expected[24];
+};
+
+// One patch per oscillator, then envelope, LFO and live controls together
+static const GoldenPatch GOLDEN[] = {
+    {{SynthWave::SINE, 5, 127, 255, 1000, 0, 0, 255, 0, 0, SynthWave::SINE, 0, 0, 0}, 64, 64,
+     {63, 81, 100, 114, 123, 126, 124, 115, 101, 83, 65, 45, 26, 12, 3, 0, 2, 11, 25, 43, 61, 81, 100, 114}},
+    {{SynthWave::SQUARE, 5, 100, 200, 2000, 0, 0, 255, 0, 0, SynthWave::SINE, 0, 0, 0}, 64, 64,
+     {100, 100, 100, 100, 100, 100, 21, 21, 21, 21, 21, 100, 100, 100, 100, 100, 21, 21, 21, 21, 21, 100, 100, 100}},
+    {{SynthWave::SAW, 5, 127, 255, 1000, 0, 0, 255, 0, 0, SynthWave::SINE, 0, 0, 0}, 64, 64,
+     {0, 6, 12, 19, 25, 31, 38, 44, 50, 57, 63, 69, 76, 82, 88, 95, 101, 107, 114, 120, 127, 6, 12, 19}},
+    {{SynthWave::TRIANGLE, 5, 127, 255, 1000, 0, 0, 255, 0, 0, SynthWave::SINE, 0, 0, 0}, 64, 64,
+     {0, 12, 25, 38, 50, 63, 76, 88, 101, 114, 127, 114, 101, 88, 76, 63, 50, 38, 25, 12, 0, 12, 25, 38}},
+    {{SynthWave::NOISE, 5, 127, 255, 5000, 0, 0, 255, 0, 0, SynthWave::SINE, 0, 0, 0}, 64, 64,
+     {0, 0, 0, 0, 104, 104, 104, 104, 119, 119, 119, 119, 11, 11, 11, 11, 126, 126, 126, 126, 11, 11, 11, 11}},
+    {{SynthWave::SINE, 5, 127, 128, 1500, 20, 30, 128, 80, 40, SynthWave::TRIANGLE, 300, 128, 64}, 96, 80,
+     {0, 26, 57, 92, 126, 113, 94, 72, 51, 33, 22, 22, 28, 40, 53, 62, 62, 45, 25, 11, 6, 7, 9, 7}},
+};
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_patches_match_golden_output(void) {
+    for (const GoldenPatch& golden : GOLDEN) {
+        HapticSynth synth;
+        SynthControls controls;
+        controls.rateCC = golden.rateCC;
+        controls.depthCC = golden.depthCC;
+        synth.reset(&golden.patch);
+        uint8_t rendered[24] = {};
+        for (uint8_t i = 0; i < 24; i++) {
+            TEST_ASSERT_TRUE(synth.render(&controls, rendered[i]));
+        }
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(golden.expected, rendered, 24);
+    }
+}
+
+void test_release_ends_the_patch(void) {
+    // Hold 80 ms + release 40 ms at 5 ms per tick
+    const GoldenPatch& golden = GOLDEN[5];
+    HapticSynth synth;
+    synth.reset(&golden.patch);
+    uint8_t amplitude;
+    uint8_t ticks = 0;
+    while (synth.render(nullptr, amplitude) && ticks < 255) {
+        ticks++;
+    }
+    TEST_ASSERT_EQUAL(24, ticks);
+}
+
+void test_const_vibe_keeps_its_level(void) {
+    // Was a {127, 10} table
+    HapticDecoder decoder(EFFECT_CONST_VIBE);
+    HapticStep step;
+    for (uint8_t i = 0; i < 50; i++) {
+        TEST_ASSERT_TRUE(decoder.next(step));
+        TEST_ASSERT_EQUAL_UINT8(127, step.amplitude);
+        TEST_ASSERT_EQUAL(5, step.delayMs);
+    }
+}
+
+void test_wave_keeps_its_table(void) {
+    const uint8_t expected[14] = {0, 20, 40, 60, 80, 100, 120, 127, 120, 100, 80, 60, 40, 20};
+    uint8_t decoded[14] = {};
+    HapticDecoder decoder(EFFECT_WAVE);
+    HapticStep step;
+    for (uint8_t i = 0; i < 14; i++) {
+        TEST_ASSERT_TRUE(decoder.next(step));
+        TEST_ASSERT_EQUAL(1, step.delayMs);
+        decoded[i] = step.amplitude;
+    }
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, decoded, 14);
+    TEST_ASSERT_FALSE(decoder.next(step));
+}
+
+int runTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_patches_match_golden_output);
+    RUN_TEST(test_release_ends_the_patch);
+    RUN_TEST(test_const_vibe_keeps_its_level);
+    RUN_TEST(test_wave_keeps_its_table);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000);  // Serial up
+    runTests();
+}
+
+void loop() {}
+#else
+int main(void) {
+    return runTests();
+}
+#endif